@@ -0,0 +1,170 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double time_ns(const Benchmark::Operation& operation, long long iterations) {
+        auto start = Clock::now();
+        for (long long i = 0; i < iterations; ++i) {
+            operation();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    std::string format_time(double ns) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(ns < 10 ? 2 : 1);
+        if (ns < 1e3) out << ns << " ns";
+        else if (ns < 1e6) out << ns / 1e3 << " us";
+        else if (ns < 1e9) out << ns / 1e6 << " ms";
+        else out << ns / 1e9 << " s";
+        return out.str();
+    }
+
+    std::string format_percent(double percent, bool sign) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << (sign && percent >= 0 ? "+" : "") << percent << "%";
+        return out.str();
+    }
+
+    std::string escape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+void BenchmarkRunner::add(Benchmark benchmark) {
+    benchmarks.push_back(std::move(benchmark));
+}
+
+void BenchmarkRunner::add(const std::string& name, Benchmark::Setup setup, int items, int samples) {
+    add(Benchmark{name, std::move(setup), items, samples});
+}
+
+void BenchmarkRunner::list(std::ostream& out) const {
+    for (const auto& benchmark : benchmarks) {
+        out << benchmark.name << std::endl;
+    }
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::run(const BenchmarkOptions& options, std::ostream& log) const {
+    std::vector<BenchmarkResult> results;
+    for (const auto& benchmark : benchmarks) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        Benchmark::Operation operation = benchmark.setup();
+        if (!operation) {
+            log << std::left << std::setw(44) << benchmark.name << std::right << " skipped" << std::endl;
+            continue;
+        }
+
+        // The first run warms the caches and tells how many runs fill a sample
+        double once = std::max(1.0, time_ns(operation, 1));
+        long long iterations = std::max(1LL, static_cast<long long>(std::ceil(options.min_sample_seconds * 1e9 / once)));
+        int samples = benchmark.samples > 0 ? benchmark.samples : std::max(1, options.samples);
+
+        std::vector<double> ns_per_op(samples);
+        for (int s = 0; s < samples; ++s) {
+            ns_per_op[s] = time_ns(operation, iterations) / iterations;
+        }
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+
+        BenchmarkResult result;
+        result.name = benchmark.name;
+        result.iterations = iterations;
+        result.items = benchmark.items;
+        result.ns_per_op = ns_per_op[samples / 2];
+        result.min_ns = ns_per_op.front();
+        result.max_ns = ns_per_op.back();
+        results.push_back(result);
+
+        log << std::left << std::setw(44) << result.name << std::right << std::setw(12) << format_time(result.ns_per_op) << "/op";
+        if (result.items > 1) {
+            log << std::setw(12) << format_time(result.ns_per_op / result.items) << "/item";
+        }
+        log << "  (" << samples << " x " << iterations << ", spread "
+            << format_percent((result.max_ns / result.min_ns - 1) * 100, false) << ")" << std::endl;
+    }
+    return results;
+}
+
+void write_json(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        out << "    {\"name\": \"" << escape(result.name) << "\", \"ns_per_op\": " << result.ns_per_op
+            << ", \"min_ns\": " << result.min_ns << ", \"max_ns\": " << result.max_ns
+            << ", \"iterations\": " << result.iterations << ", \"items\": " << result.items << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+bool read_baseline(const std::string& path, std::map<std::string, double>& baseline) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    const std::string name_key = "\"name\": \"";
+    const std::string time_key = "\"ns_per_op\": ";
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name = line.find(name_key);
+        size_t time = line.find(time_key);
+        if (name == std::string::npos || time == std::string::npos) continue;
+        name += name_key.size();
+        size_t name_end = line.find('"', name);
+        if (name_end == std::string::npos) continue;
+        baseline[line.substr(name, name_end - name)] = std::strtod(line.c_str() + time + time_key.size(), nullptr);
+    }
+    return true;
+}
+
+int compare(const std::vector<BenchmarkResult>& results, const std::map<std::string, double>& baseline,
+            double threshold_percent, std::ostream& out) {
+    int regressions = 0;
+    out << "Compared to the baseline, threshold " << threshold_percent << "%:" << std::endl;
+    for (const auto& result : results) {
+        out << "  " << std::left << std::setw(44) << result.name << std::right << std::setw(12) << format_time(result.ns_per_op);
+        auto it = baseline.find(result.name);
+        if (it == baseline.end() || it->second <= 0) {
+            out << "  new" << std::endl;
+            continue;
+        }
+        double change = (result.ns_per_op / it->second - 1) * 100;
+        out << std::setw(12) << format_time(it->second) << std::setw(10) << format_percent(change, true);
+        if (change > threshold_percent) {
+            out << "  REGRESSION";
+            regressions++;
+        } else if (change < -threshold_percent) {
+            out << "  faster";
+        }
+        out << std::endl;
+    }
+    return regressions;
+}
+
+volatile float kept_value;
+
+void keep(float value) {
+    kept_value = value;
+}
+
+QuietOutput::QuietOutput() : previous(std::cout.rdbuf(&null_buffer)) {}
+
+QuietOutput::~QuietOutput() {
+    std::cout.rdbuf(previous);
+}
@@ -0,0 +1,87 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <map>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Small benchmark harness without dependencies.
+// A benchmark is a name and a setup function. The setup runs once, untimed, and returns
+// the operation that is timed. Setups only run for the benchmarks that pass the filter,
+// so expensive ones (loading scenes) cost nothing when they are skipped.
+struct Benchmark {
+    using Operation = std::function<void()>;
+    using Setup = std::function<Operation()>;
+
+    std::string name; // "group/case/parameters"
+    Setup setup;
+    int items = 1; // Work items per operation, for the per item time
+    int samples = 0; // Overrides BenchmarkOptions::samples when > 0
+};
+
+struct BenchmarkOptions {
+    std::string filter; // Substring of the names to run, empty runs all
+    int samples = 5; // Timed samples per benchmark, the median is reported
+    double min_sample_seconds = 0.05; // Operations are repeated until a sample takes this long
+};
+
+struct BenchmarkResult {
+    std::string name;
+    long long iterations = 0; // Operations per sample
+    int items = 1;
+    double ns_per_op = 0; // Median of the samples
+    double min_ns = 0;
+    double max_ns = 0;
+};
+
+class BenchmarkRunner
+{
+public:
+    void add(Benchmark benchmark);
+    void add(const std::string& name, Benchmark::Setup setup, int items = 1, int samples = 0);
+    void list(std::ostream& out) const;
+
+    std::vector<BenchmarkResult> run(const BenchmarkOptions& options, std::ostream& log) const;
+
+private:
+    std::vector<Benchmark> benchmarks;
+};
+
+// One benchmark per line, so read_baseline does not need a full JSON parser
+void write_json(std::ostream& out, const std::vector<BenchmarkResult>& results);
+// ns_per_op by name from a file written by write_json, false when it cannot be read
+bool read_baseline(const std::string& path, std::map<std::string, double>& baseline);
+// Prints the change of every result against the baseline, returns the number of
+// benchmarks that got slower by more than threshold_percent
+int compare(const std::vector<BenchmarkResult>& results, const std::map<std::string, double>& baseline,
+            double threshold_percent, std::ostream& out);
+
+// Keeps the compiler from dropping computations whose result is not used
+void keep(float value);
+
+// Silences std::cout while it exists, the renderer logs every frame
+class QuietOutput
+{
+public:
+    QuietOutput();
+    ~QuietOutput();
+
+private:
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    NullBuffer null_buffer;
+    std::streambuf* previous;
+};
+
+// Registration functions of the benchmark files
+void register_micro_benchmarks(BenchmarkRunner& runner);
+void register_scene_benchmarks(BenchmarkRunner& runner, const std::string& scene_directory, int frames);
+
+#endif // BENCHMARK_H
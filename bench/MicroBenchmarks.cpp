@@ -0,0 +1,198 @@
+#include "Benchmark.h"
+#include "Compositor.h"
+#include "ImageGenerator.h"
+#include "KeyframeSet.h"
+#include "LineSet.h"
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace {
+    const int RESOLUTIONS[] = {256, 512, 1024};
+    const int SEGMENT_COUNTS[] = {8, 64, 512};
+    const int QUERIES = 1024; // Points or times per operation of the query benchmarks
+
+    // Deterministic inputs, the same in every run
+    struct Random {
+        uint32_t state = 12345;
+        float next() { // [0, 1)
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / 16777216.0f);
+        }
+    };
+
+    // Closed outline around the center of a size x size image, like a projected object
+    LineSet outline(int segments, int size) {
+        LineSet lineSet;
+        float radius = size * 0.35f;
+        Vector2f center(size / 2.0f, size / 2.0f);
+        auto point = [&](int i) {
+            float angle = 2.0f * static_cast<float>(M_PI) * i / segments;
+            // Slightly uneven radius, so the lines are not all the same length
+            float r = radius * (1.0f + 0.1f * std::sin(3.0f * angle));
+            return Vector2f(center.x() + r * std::cos(angle), center.y() + r * std::sin(angle));
+        };
+        for (int i = 0; i < segments; ++i) {
+            lineSet.addLine(Line(point(i), point(i + 1)));
+        }
+        return lineSet;
+    }
+
+    std::vector<Vector2f> query_points(int size) {
+        Random random;
+        std::vector<Vector2f> points(QUERIES);
+        for (auto& point : points) {
+            point = Vector2f(random.next() * size, random.next() * size);
+        }
+        return points;
+    }
+
+    std::string name(const std::string& base, int a) {
+        return base + "/" + std::to_string(a);
+    }
+
+    std::string name(const std::string& base, int a, int b) {
+        return name(base, a) + "/" + std::to_string(b);
+    }
+
+    void register_lineset(BenchmarkRunner& runner) {
+        for (int segments : SEGMENT_COUNTS) {
+            runner.add(name("lineset/get_t", segments), [segments]() -> Benchmark::Operation {
+                auto lineSet = std::make_shared<LineSet>(outline(segments, 512));
+                auto points = std::make_shared<std::vector<Vector2f>>(query_points(512));
+                return [lineSet, points]() {
+                    float sum = 0.0f;
+                    for (const auto& point : *points) sum += lineSet->get_t(point);
+                    keep(sum);
+                };
+            }, QUERIES);
+            runner.add(name("lineset/squared_distance", segments), [segments]() -> Benchmark::Operation {
+                auto lineSet = std::make_shared<LineSet>(outline(segments, 512));
+                auto points = std::make_shared<std::vector<Vector2f>>(query_points(512));
+                return [lineSet, points]() {
+                    float sum = 0.0f;
+                    for (const auto& point : *points) sum += lineSet->squaredDistance(point);
+                    keep(sum);
+                };
+            }, QUERIES);
+        }
+    }
+
+    void register_image(BenchmarkRunner& runner) {
+        for (int size : RESOLUTIONS) {
+            for (int segments : SEGMENT_COUNTS) {
+                runner.add(name("image/get_mask", size, segments), [size, segments]() -> Benchmark::Operation {
+                    auto generator = std::make_shared<ImageGenerator>(size, size);
+                    auto lineSet = std::make_shared<LineSet>(outline(segments, size));
+                    return [generator, lineSet]() {
+                        keep(static_cast<float>(generator->getMask(*lineSet).minX()));
+                    };
+                });
+                runner.add(name("image/draw_lines", size, segments), [size, segments]() -> Benchmark::Operation {
+                    auto generator = std::make_shared<ImageGenerator>(size, size);
+                    auto lineSet = std::make_shared<LineSet>(outline(segments, size));
+                    return [generator, lineSet]() {
+                        generator->clear();
+                        generator->drawLines(*lineSet, 0.25f, 0.5f);
+                    };
+                });
+            }
+            runner.add(name("image/draw_point", size), [size]() -> Benchmark::Operation {
+                auto generator = std::make_shared<ImageGenerator>(size, size);
+                Vector2f center(size / 2.0f, size / 2.0f);
+                return [generator, center]() {
+                    generator->clear();
+                    generator->drawPoint(center, 0.5f);
+                };
+            });
+            runner.add(name("image/save_image", size), [size]() -> Benchmark::Operation {
+                auto generator = std::make_shared<ImageGenerator>(size, size);
+                generator->drawLines(outline(64, size), 0.25f, 0.5f);
+                std::string path = (std::filesystem::temp_directory_path() / "platonic_bench.bmp").string();
+                return [generator, path]() {
+                    QuietOutput quiet; // saveImage prints the average color
+                    generator->saveImage(path, Vector3f(1.0f, 0.5f, 0.25f));
+                };
+            });
+        }
+    }
+
+    void register_keyframes(BenchmarkRunner& runner) {
+        for (int count : SEGMENT_COUNTS) {
+            // count keyframes with gaps between them, evaluated at sorted times like the renderer does
+            auto make_set = [count]() {
+                auto set = std::make_shared<KeyframeSet>();
+                auto& keyframes = set->channel(Channel::T);
+                for (int i = 0; i < count; ++i) {
+                    auto curve = static_cast<KeyframeCurve>(i % (static_cast<int>(KeyframeCurve::InOutElastic) + 1));
+                    keyframes.push_back(Keyframe(i * 1.0f, i * 1.0f + 0.75f, static_cast<float>(i % 7), curve));
+                }
+                set->compile();
+                return set;
+            };
+            auto times = [count]() {
+                auto times = std::make_shared<std::vector<float>>(QUERIES);
+                for (int i = 0; i < QUERIES; ++i) (*times)[i] = (count + 1.0f) * i / QUERIES - 0.5f;
+                return times;
+            };
+            runner.add(name("keyframes/get_value", count), [make_set, times]() -> Benchmark::Operation {
+                auto set = make_set();
+                auto time = times();
+                return [set, time]() {
+                    float sum = 0.0f;
+                    for (float t : *time) sum += set->get_value(set->t, t, 0.0f);
+                    keep(sum);
+                };
+            }, QUERIES);
+            runner.add(name("keyframes/compiled", count), [make_set, times]() -> Benchmark::Operation {
+                auto set = make_set();
+                auto time = times();
+                return [set, time]() {
+                    float sum = 0.0f;
+                    for (float t : *time) sum += set->get(Channel::T, t);
+                    keep(sum);
+                };
+            }, QUERIES);
+        }
+    }
+
+    void register_compositor(BenchmarkRunner& runner) {
+        for (int size : RESOLUTIONS) {
+            for (int layer_count : {1, 5}) {
+                runner.add(name("compositor/compose", size, layer_count), [size, layer_count]() -> Benchmark::Operation {
+                    struct State {
+                        Compositor compositor;
+                        std::vector<std::vector<float>> alphas;
+                        std::vector<Layer> layers;
+                        std::vector<uint8_t> rgb;
+                    };
+                    auto state = std::make_shared<State>();
+                    state->compositor = Compositor(size, size, 1, Vector3f(0.05f, 0.05f, 0.1f));
+                    state->rgb.resize(state->compositor.frame_size());
+                    state->alphas.resize(layer_count);
+                    Random random;
+                    for (int l = 0; l < layer_count; ++l) {
+                        // Mostly empty like a real layer, glow around a band through the middle
+                        auto& alpha = state->alphas[l];
+                        alpha.assign(size * size, 0.0f);
+                        for (int y = size / 3; y < 2 * size / 3; ++y) {
+                            for (int x = 0; x < size; ++x) alpha[y * size + x] = random.next();
+                        }
+                        state->layers.push_back(Layer{alpha.data(), Vector3f(random.next(), random.next(), random.next())});
+                    }
+                    return [state]() {
+                        state->compositor.compose(state->layers, state->rgb.data());
+                    };
+                });
+            }
+        }
+    }
+}
+
+void register_micro_benchmarks(BenchmarkRunner& runner) {
+    register_lineset(runner);
+    register_image(runner);
+    register_keyframes(runner);
+    register_compositor(runner);
+}
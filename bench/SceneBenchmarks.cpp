@@ -0,0 +1,55 @@
+#include "Benchmark.h"
+#include "Scene.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+namespace {
+    std::vector<std::string> find_scenes(const std::string& directory) {
+        std::vector<std::string> scenes;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            if (entry.is_directory() && std::filesystem::exists(entry.path() / "scene.txt")) {
+                scenes.push_back(entry.path().filename().string());
+            }
+        }
+        std::sort(scenes.begin(), scenes.end());
+        return scenes;
+    }
+}
+
+// Loads and renders the first frames of every scene in scene_directory. The frames are
+// streamed as Y4M to /dev/null: the timings include rendering, compositing and the color
+// conversion but neither the disk nor ffmpeg.
+void register_scene_benchmarks(BenchmarkRunner& runner, const std::string& scene_directory, int frames) {
+    std::vector<std::string> scenes = find_scenes(scene_directory);
+    if (scenes.empty()) {
+        std::cerr << "No scenes in " << scene_directory << ", skipping the scene benchmarks" << std::endl;
+        return;
+    }
+    for (const auto& scene : scenes) {
+        std::string path = (std::filesystem::path(scene_directory) / scene).string();
+        runner.add("scene/" + scene + "/load", [path]() -> Benchmark::Operation {
+            return [path]() {
+                QuietOutput quiet;
+                Scene loaded(path);
+            };
+        }, 1, 3);
+        runner.add("scene/" + scene + "/render/" + std::to_string(frames), [path, frames]() -> Benchmark::Operation {
+            std::shared_ptr<Scene> loaded;
+            {
+                QuietOutput quiet;
+                loaded = std::make_shared<Scene>(path);
+            }
+            loaded->set_y4m_output("/dev/null");
+            loaded->set_frame_range(0, frames);
+            return [loaded]() {
+                QuietOutput quiet;
+                if (loaded->render()) {
+                    loaded->finish();
+                }
+            };
+        }, frames, 3);
+    }
+}
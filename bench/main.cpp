@@ -0,0 +1,79 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    std::string json_path;
+    std::string baseline_path;
+    std::string scene_directory = ".";
+    double threshold = 10.0; // Percent
+    int frames = 30;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--samples" && i + 1 < argc) {
+            options.samples = std::atoi(argv[++i]);
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.min_sample_seconds = std::atof(argv[++i]);
+        } else if (arg == "--scenes" && i + 1 < argc) {
+            scene_directory = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--list") {
+            list = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [--filter <text>] [--json <file>] [--baseline <file>] [--threshold <percent>]"
+                      << " [--samples <n>] [--min-time <seconds>] [--scenes <dir>] [--frames <n>] [--list]" << std::endl;
+            return 1;
+        }
+    }
+
+    BenchmarkRunner runner;
+    register_micro_benchmarks(runner);
+    register_scene_benchmarks(runner, scene_directory, frames);
+    if (list) {
+        runner.list(std::cout);
+        return 0;
+    }
+
+    std::vector<BenchmarkResult> results = runner.run(options, std::cout);
+
+    if (!json_path.empty()) {
+        std::ofstream file(json_path);
+        if (!file) {
+            std::cerr << "Could not write " << json_path << std::endl;
+            return 1;
+        }
+        write_json(file, results);
+        std::cout << "Results written to " << json_path << std::endl;
+    }
+
+    if (!baseline_path.empty()) {
+        std::map<std::string, double> baseline;
+        if (!read_baseline(baseline_path, baseline)) {
+            std::cerr << "Could not read the baseline " << baseline_path << std::endl;
+            return 1;
+        }
+        int regressions = compare(results, baseline, threshold, std::cout);
+        if (regressions > 0) {
+            std::cout << regressions << " benchmark(s) slower than the baseline by more than " << threshold << "%" << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
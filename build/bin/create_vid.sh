@@ -6,15 +6,16 @@ BASE_DIR="$(cd "$(dirname "$0")" && pwd)"
 # Set the base directory to the location of this script - use absolute path
 BASE_DIR="$(cd "$(dirname "$0")" && pwd)"
 
-# Iterate over all subdirectories in the base directory
+# Collect all subdirectories in the base directory
+scenes=()
 for dir in "$BASE_DIR"/*/; do
     # Remove trailing slash and get folder name
-    folder_name=$(basename "$dir")
-    
-    # Execute PlatonicAnimation3.exe with the folder name - use full path
-    "$BASE_DIR/PlatonicAnimation3" "$folder_name"
+    scenes+=("$(basename "$dir")")
 done
 
+# Render all scenes in one process, each scene is encoded while the next one renders
+"$BASE_DIR/PlatonicAnimation3" --batch "${scenes[@]}"
+
 # Create a list of all animation_output.mp4 files
 input_files=()
 for dir in "$BASE_DIR"/*/; do
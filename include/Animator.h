@@ -2,11 +2,42 @@
 #define ANIMATOR_H
 
 #include "Camera.h"
-#include <random>
+#include "CounterNoise.h"
+#include "Hash.h"
+#include <array>
 #include "ImageGenerator.h"
 #include "KeyframeCollection.h"
 #include "KeyframeSet.h"
 
+// Everything that decides how one animator looks in one frame.
+// Evaluated from the keyframes and the frame's noise, then rendered.
+struct AnimatorState {
+    float t = 0.0f;
+    float length = 0.0f;
+    float decay_length = 0.0f;
+    float glow_length = 0.0f;
+    float point_glow_length = 0.0f;
+    Vector3f position = Vector3f::Zero();
+    float r = 0.0f;
+    float phi = 0.0f;
+    Vector3f rotation_axis = Vector3f::Zero();
+    float rotation_angle = 0.0f;
+    float scale = 0.0f;
+    // Camera shake, already scaled
+    float shear_err = 0.0f;
+    float x_err = 0.0f;
+    float y_err = 0.0f;
+    float x_offset_err = 0.0f;
+    float y_offset_err = 0.0f;
+
+    // All fields in a fixed order, for hashing and comparing
+    std::array<float, 20> values() const;
+    bool operator==(const AnimatorState& other) const { return values() == other.values(); }
+    bool operator!=(const AnimatorState& other) const { return !(*this == other); }
+};
+
+void add_to_hash(Fnv1a& hash, const AnimatorState& state);
+
 class Animator
 {
 private:
@@ -18,24 +49,62 @@ private:
     int fps;
     
     KeyframeSet keyframeSet;
-    std::mt19937 gen;
-    std::normal_distribution<float> dist;
+    CounterNoise noise;
     bool debug_mode = false;
+    AnimatorState last_state; // State the layer currently shows
+    bool has_last_state = false;
+    std::vector<std::pair<int, int>> active_frames; // Sorted [first, last) frame intervals that can draw
+    bool has_activity = false;
+    const float* baked = nullptr; // Timeline table, one row of CHANNEL_COUNT values per frame
+    int baked_frames = 0;
+    bool draws_nothing(const AnimatorState& state) const;
+    // Places the object and the camera for state and projects the visible path
+    LineSet project(const AnimatorState& state);
+    // Channels of the frame, from the timeline when one is set and covers the frame
+    void sample(float time, int frame, float* channels);
 public:
     Animator();
     Animator(std::string name, Vector3f color,Camera cam, ImageGenerator imgGen, Object object, int fps);
     // void animate(const std::string& filename) const; //Saves the entire animation as images (bmp)
-    void render_frame(float time);
+    AnimatorState evaluate(float time, int frame);
+    // All keyframe channels at time, in Channel order
+    void sample_keyframes(float time, float* channels);
+    // All channels at all times, one row of CHANNEL_COUNT values per time, through the
+    // batch curve path. Same values as the scalar version.
+    void sample_keyframes(const std::vector<float>& times, float* table);
+    // Reads the channels from a baked table instead of the keyframes, see Timeline.
+    // The table must outlive the animator and its copies.
+    void set_timeline(const float* table, int frame_count);
+    // Draws the state into the layer. Returns false and keeps the layer when the state
+    // equals the one already drawn.
+    bool render(const AnimatorState& state);
+    bool render_frame(float time, int frame);
+    // Pixel shading work of render() for state, without drawing. Used to balance shards.
+    float estimate_cost(const AnimatorState& state);
     void load_keyframes(const std::string& filename);
+    const KeyframeSet& get_keyframes() const { return keyframeSet; }
     Vector3f get_color() const;
     std::string get_name() const;
     float get_start_time() const;
     float get_end_time() const;
     void clear();
-    std::vector<float> get_alpha() {
+    const std::vector<float>& get_alpha() const {
         return imageGenerator.get_alpha();
     }
+    const Rect& get_dirty() const {
+        return imageGenerator.get_dirty();
+    }
+    // Precomputes the frames in which the animator is visible from its scale, length and
+    // point glow tracks. Frames outside are evaluated to the empty state without projecting.
+    void build_activity(const std::vector<float>& frame_times);
+    bool is_active(int frame) const;
     void set_debug_mode(bool mode);
+    void set_render_settings(const RenderSettings& settings);
+    void set_falloff_cache(const std::shared_ptr<FalloffCache>& cache);
+    // Noise depends only on (seed, stream, frame), stream is the animator index
+    void set_noise(uint64_t seed, uint32_t stream);
+    // Everything besides the state that decides the layer: color and geometry
+    void add_to_hash(Fnv1a& hash) const;
 
 };
 
@@ -0,0 +1,48 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scene.h"
+
+// Renders several scenes in one process. The OpenMP team is created once and reused
+// by every scene, and each scene is finished (remaining frames written, ffmpeg run)
+// on a background thread while the next one renders.
+class BatchRenderer
+{
+public:
+    struct SceneTiming {
+        std::string name;
+        int frames = 0;
+        double load_seconds = 0;
+        double render_seconds = 0;
+        double finish_seconds = 0; // Writing and encoding, overlapped with the next scene
+        bool ok = false;
+    };
+
+    explicit BatchRenderer(std::vector<std::string> scene_names);
+    ~BatchRenderer();
+
+    // Applied to every scene
+    void set_frame_cache(const std::string& directory) { frame_cache_dir = directory; }
+
+    // False when a scene had nothing to render
+    bool run();
+    void print_summary(std::ostream& out) const;
+
+private:
+    void wait_for_finish();
+
+    std::vector<std::string> scene_names;
+    std::string frame_cache_dir;
+    std::vector<SceneTiming> timings;
+
+    std::unique_ptr<Scene> finishing; // Scene being finished by finish_thread
+    std::thread finish_thread;
+    double total_seconds = 0;
+};
+
+#endif // BATCHRENDERER_H
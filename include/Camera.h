@@ -9,6 +9,7 @@
 using Eigen::Vector2f;
 using Eigen::Vector3f;
 using Eigen::MatrixXf;
+using Matrix23f = Eigen::Matrix<float, 2, 3>;
 
 class Camera {
 public:
@@ -18,14 +19,21 @@ public:
     std::vector<Vector2f> getScreenPos(std::vector<Object> &objects);
     std::vector<Vector2f> getScreenPos(std::vector<Vector3f> &points);
     Vector2f get_screen_position(const Vector3f& world_position, const Object& object) const;
-    LineSet convert_to_lines(const Object& object) const;
-    LineSet convert_to_lines(const Object &object, float start_t, float length) const;
-    Vector2f get_point(float start_t, const Object &object) const;
-    MatrixXf projectionMatrix;
+    // Both project the object first, the lines are built from the projected vertices
+    LineSet convert_to_lines(const Object& object);
+    LineSet convert_to_lines(const Object &object, float start_t, float length);
+    // Projects all vertices of object to the screen, once per frame
+    void project(const Object& object);
+    const std::vector<Vector2f>& get_projected_points() const { return projected_points; }
+    // Point at t along the outline of the last projected object
+    Vector2f get_point(float t) const;
+    Matrix23f projectionMatrix;
     void set_proj_matrix();
     void set_error(float shear, float x_offset, float y_offset, float x_err, float y_err);
 
 private:
+    Vector2f apply_projection(const Vector3f& point) const;
+
     float f;
     float shear_error;
     float x_scale_error;
@@ -37,6 +45,7 @@ private:
     float H; // Height of the camera view
     int w; // Width of the camera's viewport in pixels
     int h; // Height of the camera's viewport in pixels
+    std::vector<Vector2f> projected_points; // Screen positions of the vertices, reused every frame
 };
 
 #endif // CAMERA_H
\ No newline at end of file
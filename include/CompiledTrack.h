@@ -0,0 +1,86 @@
+#ifndef COMPILEDTRACK_H
+#define COMPILEDTRACK_H
+
+#include <cstdint>
+#include <vector>
+#include "EasingCurves.h"
+#include "Keyframe.h"
+
+// Channels of a KeyframeSet
+enum class Channel {
+    T,
+    Length,
+    DecayLength,
+    GlowLength,
+    PointGlowLength,
+    PositionX,
+    PositionY,
+    PositionZ,
+    RotationX,
+    RotationY,
+    RotationZ,
+    RotationAngle,
+    Scale,
+    CamShiftErr,
+    ObjShiftErr,
+    CamShearErr,
+    R,
+    Phi,
+    Count
+};
+const int CHANNEL_COUNT = static_cast<int>(Channel::Count);
+
+// Branch KeyframeSet::get_value takes at one time
+struct TrackRule {
+    enum Kind : uint8_t { Constant, Interpolate };
+    Kind kind = Constant;
+    float value = 0.0f; // Constant value, or the resolved start value
+    int keyframe = -1; // Interpolated keyframe
+};
+
+// One keyframe channel compiled into a flat piecewise function.
+// get_value only compares the time against keyframe start and end times, so on each
+// boundary and on each open interval between two boundaries it always takes the same
+// branch. compile() resolves that branch once per piece (gaps, holds, NaN start values);
+// a lookup then finds the piece and evaluates one curve, with the same float expression.
+class CompiledTrack
+{
+public:
+    CompiledTrack() = default;
+    static CompiledTrack compile(const std::vector<Keyframe>& keyframes, float default_value);
+
+    // Reference semantics, the branch get_value takes at time
+    static TrackRule classify(const std::vector<Keyframe>& keyframes, float time, float default_value);
+    static float evaluate(const TrackRule& rule, const std::vector<Keyframe>& keyframes, float time);
+
+    // Starts from the piece of the last lookup, O(1) for playback, binary search otherwise
+    float value(float time);
+    // No cursor, for random access from const code
+    float value_at(float time) const;
+    // value_at for many times. Consecutive times in the same piece go through the
+    // batch curve path together, with the same values as value_at.
+    void values(const float* times, float* out, size_t count) const;
+
+    size_t piece_count() const { return kind.size(); }
+
+private:
+    size_t find(float time, size_t hint) const; // Index of the first boundary >= time
+    size_t piece(size_t k, float time) const;
+    float evaluate_piece(size_t piece, float time) const;
+
+    float default_value = 0.0f;
+    bool constant = true; // Same value at all times, most channels of a scene hold one value
+    float constant_value = 0.0f;
+    std::vector<float> bounds; // Sorted, unique keyframe start and end times
+    std::vector<float> limits; // bounds between -inf and +inf sentinels, boundary k is limits[k + 1]
+    // Piece 2k is the open interval below bounds[k], piece 2k+1 is bounds[k] itself
+    std::vector<TrackRule::Kind> kind;
+    std::vector<float> start_value;
+    std::vector<float> start_time;
+    std::vector<float> duration;
+    std::vector<float> delta;
+    std::vector<KeyframeCurve> curve;
+    size_t cursor = 0;
+};
+
+#endif // COMPILEDTRACK_H
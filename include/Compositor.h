@@ -0,0 +1,39 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+#include "Rect.h"
+
+using Eigen::Vector3f;
+
+// Alpha layer of one animator, read in place
+struct Layer {
+    const float* alpha;
+    Vector3f color;
+    const Rect* rect = nullptr; // Live bounds of the non zero alpha, nullptr = whole frame
+};
+
+// Blends the animator layers over the background and writes the 8 bit frame in one pass.
+// The alpha buffers are only read, nothing is copied per frame.
+class Compositor
+{
+public:
+    Compositor();
+    Compositor(int width, int height, int upscale_factor, const Vector3f& background);
+
+    void compose(const std::vector<Layer>& layers, uint8_t* rgb) const;
+    // Only rewrites the pixels inside region, the rest of rgb is left as it is
+    void compose(const std::vector<Layer>& layers, uint8_t* rgb, const Rect& region) const;
+    Rect full_frame() const;
+    size_t frame_size() const; // Bytes of one upscaled RGB frame
+
+private:
+    int width;
+    int height;
+    int upscale_factor;
+    Vector3f background;
+};
+
+#endif // COMPOSITOR_H
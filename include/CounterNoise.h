@@ -0,0 +1,42 @@
+#ifndef COUNTERNOISE_H
+#define COUNTERNOISE_H
+
+#include <cmath>
+#include <cstdint>
+
+// Counter-based gaussian noise.
+// Every sample is a pure function of (seed, stream, frame, sample), so frames can be
+// rendered in any order, on any thread, and the result is reproducible between runs.
+class CounterNoise
+{
+public:
+    CounterNoise() = default;
+    CounterNoise(uint64_t seed, uint32_t stream) : seed(seed), stream(stream) {}
+
+    // Standard normal sample (Box-Muller on two hashed uniforms)
+    float normal(uint32_t frame, uint32_t sample) const {
+        uint64_t counter = (static_cast<uint64_t>(frame) << 32) | (static_cast<uint64_t>(sample) << 1);
+        uint64_t key = splitmix64(seed ^ splitmix64(stream));
+        double u1 = uniform(splitmix64(key ^ counter));
+        double u2 = uniform(splitmix64(key ^ (counter | 1)));
+        return static_cast<float>(std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2));
+    }
+
+private:
+    uint64_t seed = 0;
+    uint32_t stream = 0;
+
+    static uint64_t splitmix64(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // (0, 1), never 0 so the log above stays finite
+    static double uniform(uint64_t x) {
+        return (static_cast<double>(x >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+};
+
+#endif // COUNTERNOISE_H
@@ -0,0 +1,24 @@
+#ifndef EASINGCURVES_H
+#define EASINGCURVES_H
+
+#include <cstddef>
+#include "Keyframe.h"
+
+// All easing curves in one place.
+// apply() is the reference every renderer uses. The batch functions evaluate one curve
+// over an array of normalized times, with the curve dispatch resolved once per segment,
+// and give the same results as apply(), bit for bit.
+class EasingCurves
+{
+public:
+    // out may be the same array as t
+    using BatchFunction = void (*)(const float* t, float* out, size_t count);
+
+    static float apply(float t, KeyframeCurve curve);
+    static BatchFunction batch(KeyframeCurve curve);
+    static void apply(const float* t, float* out, size_t count, KeyframeCurve curve) {
+        batch(curve)(t, out, count);
+    }
+};
+
+#endif // EASINGCURVES_H
@@ -0,0 +1,54 @@
+#ifndef FALLOFFCACHE_H
+#define FALLOFFCACHE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// Lookup table for the glow falloff exp(-d/glow_length/conversion_factor)
+struct FalloffTable {
+    float glow_length = 0.0f;
+    float conversion_factor = 1.0f;
+    float extent = 0.0f; // Largest squared distance (radial) or distance (line) covered by the table
+    float samples_per_pixel = 1.0f; // Only used by line tables
+    std::vector<float> values;
+
+    // Line tables: linear interpolation over the distance d = sqrt(squared_distance).
+    // With 32 samples per pixel the relative error is below 1/(8192*(glow_length*conversion_factor)^2).
+    // Distances past the end of the table are evaluated directly.
+    float at_distance(float squared_distance) const;
+};
+
+// Falloff tables shared by all image generators of a scene.
+// Keyframe files repeat the same glow lengths for long stretches, so tables are reused
+// across frames and animators. Keys are the exact float values, no quantization.
+class FalloffCache
+{
+public:
+    // Indexed by the integer squared distance 0..max_squared_distance, matches drawPoint exactly
+    std::shared_ptr<const FalloffTable> radial(float glow_length, float conversion_factor, int max_squared_distance);
+    // Indexed by distance with interpolation, covers 0..max_distance
+    std::shared_ptr<const FalloffTable> line(float glow_length, float conversion_factor, float max_distance);
+
+    size_t size() const;
+
+private:
+    enum class Kind { Radial, Line };
+    using Key = std::tuple<Kind, float, float, float>;
+    struct Entry {
+        std::shared_ptr<const FalloffTable> table;
+        unsigned long last_use;
+    };
+
+    std::shared_ptr<const FalloffTable> lookup(const Key& key);
+    void insert(const Key& key, const std::shared_ptr<const FalloffTable>& table);
+
+    static const size_t MAX_ENTRIES = 64;
+    mutable std::mutex mutex;
+    std::map<Key, Entry> entries;
+    unsigned long use_counter = 0;
+};
+
+#endif // FALLOFFCACHE_H
@@ -0,0 +1,33 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Persistent cache of finished 8 bit frames, addressed by a hash of everything that
+// decides the frame (see Scene::frame_key). Shared by all scenes that use the same directory.
+class FrameCache
+{
+public:
+    explicit FrameCache(const std::string& directory);
+
+    // False on a miss or when the file is damaged or of another size
+    bool load(uint64_t key, std::vector<uint8_t>& frame);
+    // Written to a temporary file and renamed, so concurrent renders never see partial frames
+    void store(uint64_t key, const std::vector<uint8_t>& frame);
+
+    void print_summary(std::ostream& out) const;
+
+private:
+    std::string path(uint64_t key) const;
+
+    std::string directory;
+    std::atomic<int> hits{0};
+    std::atomic<int> misses{0};
+    std::atomic<int> stored{0};
+};
+
+#endif // FRAMECACHE_H
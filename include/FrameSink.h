@@ -0,0 +1,56 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Destination for finished 8 bit RGB frames. Frames arrive in order, from one thread.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+    virtual bool write(int frame_number, const std::vector<uint8_t>& rgb) = 0;
+    virtual void close() {}
+};
+
+// One frame_%05d.bmp per frame, the input of the ffmpeg encode
+class BmpSink : public FrameSink
+{
+public:
+    BmpSink(const std::string& directory, int width, int height);
+    bool write(int frame_number, const std::vector<uint8_t>& rgb) override;
+    static std::string frame_path(const std::string& directory, int frame_number);
+
+private:
+    std::string directory;
+    int width;
+    int height;
+};
+
+// YUV4MPEG2 stream (yuv420p, BT.601 limited range) to a file, a FIFO or "-" for stdout.
+// Any encoder can read it live, e.g. ffmpeg -i pipe.y4m
+class Y4mSink : public FrameSink
+{
+public:
+    Y4mSink(const std::string& path, int width, int height, int fps);
+    ~Y4mSink() override;
+    bool write(int frame_number, const std::vector<uint8_t>& rgb) override;
+    void close() override;
+
+private:
+    std::string path;
+    int width;
+    int height;
+    int fps;
+    FILE* file = nullptr;
+    bool failed = false;
+    std::vector<uint8_t> yuv; // Y plane, then U and V at half resolution
+};
+
+// Fixed point RGB -> yuv420p, chroma from the average of each 2x2 block.
+// yuv must hold width*height + 2*((width+1)/2)*((height+1)/2) bytes.
+void rgb_to_yuv420(const uint8_t* rgb, int width, int height, uint8_t* yuv);
+
+#endif // FRAMESINK_H
@@ -0,0 +1,67 @@
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Writes finished frames on a background thread, in frame order.
+// Frames live in a fixed pool of buffers: the renderer acquires one, composes into it
+// and submits it. acquire() blocks only when the writer is queue_size frames behind.
+class FrameWriter
+{
+public:
+    using WriteFunction = std::function<void(int frame_number, const std::vector<uint8_t>& data)>;
+
+    // Totals of one or more writers
+    struct Stats {
+        int frames_written = 0;
+        int queue_size = 0;
+        size_t max_depth = 0;
+        size_t depth_sum = 0; // Queue depth seen at every submit
+        double stall_seconds = 0.0; // Renderer time blocked in acquire
+        double write_seconds = 0.0; // Writer time spent in write
+    };
+
+    FrameWriter(size_t frame_size, int queue_size, int first_frame, WriteFunction write);
+    ~FrameWriter();
+
+    // Frames are admitted in order: frame_number must be below the next unwritten
+    // frame + queue_size. The oldest missing frame can always get a buffer, so
+    // frame parallel renderers never deadlock.
+    std::vector<uint8_t>* acquire(int frame_number);
+    void submit(int frame_number, std::vector<uint8_t>* buffer);
+    // Waits until all submitted frames are written and stops the thread
+    void finish();
+    // First frame not written yet, all frames before it are
+    int written_until() const;
+
+    // Adds the statistics of this writer to totals
+    void add_stats(Stats& totals) const;
+    static void print_summary(std::ostream& out, const Stats& stats);
+
+private:
+    void run();
+
+    WriteFunction write;
+    int queue_size;
+    std::vector<std::vector<uint8_t>> buffers;
+    std::vector<std::vector<uint8_t>*> free_buffers;
+    std::map<int, std::vector<uint8_t>*> pending; // Submitted, not yet written
+    int next_frame; // Next frame to hand to write
+    bool done = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable frame_ready;
+    std::condition_variable buffer_free;
+    std::thread thread;
+
+    Stats stats;
+};
+
+#endif // FRAMEWRITER_H
@@ -0,0 +1,44 @@
+#ifndef GLOWKERNEL_H
+#define GLOWKERNEL_H
+
+#include <vector>
+#include "LineSet.h"
+#include "FalloffCache.h"
+
+// Shades runs of pixels that share one list of candidate lines (see SegmentGrid::run).
+// The lines are copied into a structure-of-arrays layout so the AVX2 path can
+// evaluate 8 pixels per instruction. The scalar path picks the same lines as
+// SegmentGrid::nearest and reads the glow falloff from a FalloffTable.
+class GlowKernel
+{
+public:
+    GlowKernel();
+
+    void setLines(const LineSet& lineSet);
+    void setGlow(float glow_length, float decay_length, float conversion_factor, const FalloffTable& falloff);
+    void shadeRun(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const;
+    void set_simd(bool enabled) { simd = enabled && avx2Supported(); }
+    bool get_simd() const { return simd; }
+
+    static bool avx2Supported();
+
+private:
+    void shadeRunScalar(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const;
+    void shadeRunAvx2(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const;
+
+    const LineSet* lineSet;
+    std::vector<float> start_x;
+    std::vector<float> start_y;
+    std::vector<float> end_x;
+    std::vector<float> end_y;
+    std::vector<float> direction_x;
+    std::vector<float> direction_y;
+    std::vector<float> squared_length;
+    float glow_length;
+    float decay_length;
+    float conversion_factor;
+    const FalloffTable* falloff;
+    bool simd;
+};
+
+#endif // GLOWKERNEL_H
@@ -0,0 +1,75 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Placement of one glyph in a GlyphAtlas. Pixel offsets are relative to the pen position
+// on the baseline, y down.
+struct GlyphSprite {
+    int width = 0; // Sprite size, the glyph plus the glow margin on every side
+    int height = 0;
+    int left = 0; // Top left corner of the sprite
+    int top = 0;
+    int advance = 0; // Pen movement to the next glyph
+    size_t offset = 0; // First pixel in the atlas planes
+};
+
+// Glyphs rasterized once into two coverage planes: the sharp core and its Gaussian glow.
+// The glow of a line of text is the sum of the glow sprites of its glyphs, the blur is
+// linear. Reads a TrueType or OpenType font with FreeType when the build has it
+// (PLATONIC_FREETYPE), otherwise or without a font file a built-in 5x7 pixel font scaled
+// to the size.
+class GlyphAtlas
+{
+public:
+    GlyphAtlas();
+    // size: pixel size of the font (em height), glow_radius: standard deviation of the glow
+    GlyphAtlas(const std::string& font_path, int size, float glow_radius);
+    ~GlyphAtlas();
+    GlyphAtlas(GlyphAtlas&&) noexcept;
+    GlyphAtlas& operator=(GlyphAtlas&&) noexcept;
+
+    // Rasterizes the characters of text that are not in the atlas yet. Not thread safe,
+    // everything else only reads.
+    void add(const std::u32string& text);
+    // Sprite of c, the replacement glyph when the font has none, nullptr before add()
+    const GlyphSprite* find(char32_t c) const;
+    const float* core(const GlyphSprite& sprite) const { return core_plane.data() + sprite.offset; }
+    const float* glow(const GlyphSprite& sprite) const { return glow_plane.data() + sprite.offset; }
+    int line_height() const { return line_height_; }
+    // False when the built-in font is used, also when the font file could not be loaded
+    bool uses_freetype() const { return freetype != nullptr; }
+
+private:
+    struct Coverage {
+        int width = 0;
+        int height = 0;
+        int left = 0;
+        int top = 0;
+        int advance = 0;
+        std::vector<float> values;
+    };
+    struct FreeTypeFont;
+
+    bool rasterize(char32_t c, Coverage& coverage) const;
+    void rasterize_builtin(char32_t c, Coverage& coverage) const;
+    void insert(char32_t c, const Coverage& coverage);
+
+    std::unique_ptr<FreeTypeFont> freetype; // nullptr: built-in font
+    int builtin_scale = 1;
+    int line_height_ = 0;
+    float glow_radius = 0.0f;
+    std::vector<float> kernel; // Normalized Gaussian, 2 * margin + 1 taps
+    int margin = 0;
+    std::unordered_map<char32_t, GlyphSprite> sprites;
+    std::vector<float> core_plane;
+    std::vector<float> glow_plane;
+};
+
+// Code points of UTF-8 text, U+FFFD for invalid bytes
+std::u32string decode_utf8(const std::string& text);
+
+#endif // GLYPHATLAS_H
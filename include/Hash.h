@@ -0,0 +1,36 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 64 bit FNV-1a over the exact bytes of the values fed in
+class Fnv1a
+{
+public:
+    void add(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            value = (value ^ bytes[i]) * 0x100000001B3ull;
+        }
+    }
+    void add(float v) {
+        if (v == 0.0f) v = 0.0f; // -0 and +0 render the same
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        add(&bits, sizeof(bits));
+    }
+    void add(int32_t v) { add(&v, sizeof(v)); }
+    void add(uint64_t v) { add(&v, sizeof(v)); }
+    void add(const std::string& s) {
+        add(static_cast<uint64_t>(s.size()));
+        add(s.data(), s.size());
+    }
+    uint64_t get() const { return value; }
+
+private:
+    uint64_t value = 0xCBF29CE484222325ull;
+};
+
+#endif // HASH_H
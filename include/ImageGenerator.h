@@ -4,9 +4,33 @@
 #include <Eigen/Dense>
 #include <vector>
 #include "LineSet.h"
+#include "SegmentGrid.h"
+#include "GlowKernel.h"
+#include "FalloffCache.h"
+#include "Rect.h"
+#include <memory>
 
 using namespace Eigen;
 
+// Raster engine used by drawLines
+enum class RenderEngine {
+    Mask,    // Rectangle mask around the path, nearest line queried per pixel
+    Capsule  // Every line rasterizes its own capsule and max-blends into alpha
+};
+
+// Raster settings of a scene, see Scene::load_options
+struct RenderSettings {
+    RenderEngine engine = RenderEngine::Mask;
+    bool simd = true; // Use the AVX2 glow kernel when the CPU supports it
+    int tile_size = 32; // Edge of the screen tiles handed to one thread each
+};
+
+// Screen tile, top left pixel
+struct Tile {
+    int x;
+    int y;
+};
+
 class ImageGenerator {
 public:
     ImageGenerator();
@@ -16,24 +40,45 @@ public:
     void drawLines(const LineSet& lineSet, const float& decay_length=0.25f, const float& glow_length=0.5f);
     void drawPoint(const Vector2f& point, const float& glow_length);
     void saveImage(const std::string& filename, const Vector3f& color);
-    std::vector<Vector2i> getMask(const LineSet& lineSet) const;
+    const SpanMask& getMask(const LineSet& lineSet);
+    // Pixel shading work of drawLines and drawPoint for a path of line_count lines and
+    // path_length pixels: the capsule around every line, overlaps counted once per line
+    // like the glow kernel visits them, plus the square of the point glow
+    float support_area(float path_length, int line_count, float point_glow_length) const;
     void normalize();
-    void clear() {
-        std::fill(alpha.begin(), alpha.end(), 0.0f);
-    };
-    std::vector<float> get_alpha() {return alpha;}
+    void clear(); // Zeroes only the dirty rectangle
+    const std::vector<float>& get_alpha() const {return alpha;}
+    // Bounds of every pixel written since the last clear, alpha is zero outside
+    const Rect& get_dirty() const {return dirty;}
     void set_debug_mode(bool mode);
+    void set_render_settings(const RenderSettings& settings);
+    void set_falloff_cache(const std::shared_ptr<FalloffCache>& cache);
 
 
 private:
     int width;
     int height;
     std::vector<float> alpha;
+    Rect dirty;
     float gauss(float x, float y, float sigma);
+    void drawLinesMask(const LineSet& lineSet, const float& decay_length, const float& glow_length);
+    void drawLinesCapsule(const LineSet& lineSet, const float& decay_length, const float& glow_length);
+    const FalloffTable& lineFalloff(float glow_length);
+    void collectTiles(int min_x, int max_x, int min_y, int max_y, int origin_x, int origin_y);
     float conversion_factor = 1.0f;
     int max_radius = 7;
     float max_line_distance = 7.0f;
+    SegmentGrid segment_grid; // Rebuilt for every drawn LineSet, keeps its storage between frames
+    SpanMask span_mask; // Same, for the covered pixels
+    std::vector<Tile> tiles; // Tiles of the current draw call in traversal order
+    std::vector<int> tile_start; // Lines binned per tile for the capsule engine
+    std::vector<int> tile_lines;
+    GlowKernel glow_kernel;
+    std::shared_ptr<FalloffCache> falloff_cache; // Shared with the other generators of the scene
+    std::shared_ptr<const FalloffTable> point_falloff; // Tables of the last drawn glow lengths
+    std::shared_ptr<const FalloffTable> line_falloff;
     bool debug_mode = false;
+    RenderSettings render_settings;
 };
 
 #endif // IMAGE_GENERATOR_H
\ No newline at end of file
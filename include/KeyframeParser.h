@@ -0,0 +1,49 @@
+#ifndef KEYFRAMEPARSER_H
+#define KEYFRAMEPARSER_H
+
+#include <string>
+#include <string_view>
+#include "Keyframe.h"
+
+struct KeyframeSet;
+
+// Single pass parser for the "# KeyframeSet" format, reading the memory mapped file
+// through string_views without copying lines or tokens.
+//
+//   K <channel>                                   starts a block, ends at an empty line
+//   <start_time> <start_value> <end_time> <end_value> [curve]
+//   <start_time> <end_time> <end_value> <curve>   starts at the previous end value
+//
+// Values are expressions of numbers, p and + - * /. They are compiled the way the
+// original parser evaluated them: split at the first '+', else the first '-', '*', '/',
+// evaluate both sides in float, and replace p by std::to_string(M_PI). So a-b-c is
+// a-(b-c) and 2p reads as "23.141593". A leading '-' negates.
+// Problems are reported as file:line:column on std::cerr.
+class KeyframeParser
+{
+public:
+    // Appends the keyframes to the channels of set, false when the file cannot be read
+    static bool parse_file(const std::string& path, KeyframeSet& set);
+    static void parse(std::string_view text, const std::string& name, KeyframeSet& set);
+
+    // One value, errors are reported at line and column of name
+    static float parse_value(std::string_view text, const std::string& name = "<value>", int line = 1, int column = 1);
+    static bool parse_curve(std::string_view text, KeyframeCurve& curve);
+
+private:
+    KeyframeParser(std::string_view text, const std::string& name) : text(text), name(name) {}
+
+    void run(KeyframeSet& set);
+    Keyframe keyframe(std::string_view line);
+    float expression(std::string_view expr);
+    float number(std::string_view atom);
+    void report(const char* level, std::string_view at, const std::string& message) const;
+
+    std::string_view text;
+    const std::string& name;
+    std::string_view line_text; // Line being parsed, for the column of a token
+    int line_number = 0;
+    int column_offset = 0; // Added to columns, for parse_value
+};
+
+#endif // KEYFRAMEPARSER_H
@@ -1,6 +1,9 @@
 
 
 #include "KeyframeCollection.h"
+#include "CompiledTrack.h"
+#include <array>
+#include <utility>
 
 struct KeyframeSet{
     std::vector<Keyframe> t;
@@ -22,78 +25,90 @@ struct KeyframeSet{
     std::vector<Keyframe> r;
     std::vector<Keyframe> phi;
 
+    // Compiled from the vectors above by compile(), used by all getters
+    std::array<CompiledTrack, CHANNEL_COUNT> tracks;
+
+    float get(Channel channel, float time) {
+        return tracks[static_cast<int>(channel)].value(time);
+    }
+
     float get_t(float time) {
-        return get_value(t, time, 0.0f);
+        return get(Channel::T, time);
     }
 
     float get_length(float time) {
-        return get_value(length, time, 0.0f);
+        return get(Channel::Length, time);
     }
 
     float get_decay_length(float time) {
-        return get_value(decay_length, time, 0.0f);
+        return get(Channel::DecayLength, time);
     }
 
     float get_glow_length(float time) {
-        return get_value(glow_length, time, 0.5f);
+        return get(Channel::GlowLength, time);
     }
 
     float get_point_glow_length(float time) {
-        return get_value(point_glow_length, time, 1.0f);
+        return get(Channel::PointGlowLength, time);
     }
 
     Vector3f get_object_position(float time) {
-        return Vector3f(get_value(object_position_x, time, 0.0f), get_value(object_position_y, time, 0.0f), get_value(object_position_z, time, 0.0f));
+        return Vector3f(get(Channel::PositionX, time), get(Channel::PositionY, time), get(Channel::PositionZ, time));
     }
 
     Vector3f get_object_rotation_axis(float time) {
-        return Vector3f(get_value(object_rotation_x, time, 0.0f), get_value(object_rotation_y, time, 0.0f), get_value(object_rotation_z, time, 0.0f)).normalized();
+        return Vector3f(get(Channel::RotationX, time), get(Channel::RotationY, time), get(Channel::RotationZ, time)).normalized();
     }
 
     float get_object_rotation_angle(float time) {
-        return get_value(object_rotation_angle, time, 0.0f);
+        return get(Channel::RotationAngle, time);
     }
 
     float get_object_scale(float time) {
-        return get_value(object_scale, time, 0.0f);
+        return get(Channel::Scale, time);
     }
 
     float get_cam_shift_err(float time) {
-        return get_value(cam_shift_err, time, 0.0f);
+        return get(Channel::CamShiftErr, time);
     }
 
     float get_obj_shift_err(float time) {
-        return get_value(obj_shift_err, time, 0.0f);
+        return get(Channel::ObjShiftErr, time);
     }
 
     float get_cam_shear_err(float time) {
-        return get_value(cam_shear_err, time, 0.0f);
+        return get(Channel::CamShearErr, time);
     }
 
     float get_r(float time) {
-        return get_value(r, time, 0.0f);
+        return get(Channel::R, time);
     }
 
     float get_phi(float time) {
-        return get_value(phi, time, 0.0f);
+        return get(Channel::Phi, time);
     }
 
     KeyframeSet(std::vector<KeyframeCollection> collections);
     KeyframeSet(const std::string& filename);
-    KeyframeSet() = default;
+    KeyframeSet();
 
     void check_for_overlaps();
     void sort_keyframes();
+    // Rebuilds the tracks, call after changing the keyframe vectors
+    void compile();
+    std::vector<Keyframe>& channel(Channel channel);
+    const std::vector<Keyframe>& channel(Channel channel) const;
+    static float default_value(Channel channel);
 
     float get_start_time() const;
     float get_end_time() const;
     float get_vector_end_time(const std::vector<Keyframe>& keyframes) const;
     float get_vector_start_time(const std::vector<Keyframe>& keyframes) const;
 
-    float apply_curve(float t, KeyframeCurve curve) const;
     float get_value(std::vector<Keyframe>& keyframes, float time, float default_val);
-    KeyframeCurve string_to_curve(const std::string& str);
-    Keyframe parse_keyframe(const std::string& line);
-    float convert_string_to_float(std::string str);
+
+    // Sorted, disjoint closed time intervals outside of which a channel with the current
+    // keyframes has the same value as one with the previous keyframes
+    static std::vector<std::pair<float, float>> changed_intervals(const std::vector<Keyframe>& previous, const std::vector<Keyframe>& current);
 };
 
@@ -2,11 +2,20 @@
 #define LINESET_H
 
 #include <vector>
+#include <limits>
 #include <Eigen/Dense>
 #include "Line.h"
+#include "SpanMask.h"
 
 using Vector2i = Eigen::Vector2i;
 
+// Result of a nearest-line query
+struct SegmentHit {
+    int index = -1; // Index of the closest line, -1 if none was found
+    float t = std::numeric_limits<float>::max(); // Unclamped parameter on that line
+    float squared_distance = std::numeric_limits<float>::max();
+};
+
 class LineSet
 {
 public:
@@ -16,8 +25,10 @@ public:
 
     void addLine(const Line& line);
     float get_t(const Vector2f& point) const;
+    float get_t(const SegmentHit& hit) const;
+    SegmentHit nearest(const Vector2f& point) const;
     float squaredDistance(const Vector2f& point) const;
-    std::vector<Vector2i> getMask(float size) const;
+    void getSpans(float size, SpanMask& mask) const;
     Vector2f getStartPoint() const;
     std::vector<Line> lines;
 
@@ -0,0 +1,49 @@
+#ifndef LINESOCKET_H
+#define LINESOCKET_H
+
+#include <string>
+
+// Connected stream socket exchanging text lines, used between the render coordinator and
+// its workers. Addresses are "tcp:<port>" for TCP on localhost, anything else ("unix:<path>"
+// or just a path) is a Unix domain socket.
+class LineSocket
+{
+public:
+    LineSocket() = default;
+    explicit LineSocket(int fd) : fd_(fd) {}
+    ~LineSocket();
+    LineSocket(const LineSocket&) = delete;
+    LineSocket& operator=(const LineSocket&) = delete;
+    LineSocket(LineSocket&& other) noexcept;
+    LineSocket& operator=(LineSocket&& other) noexcept;
+
+    // False when nothing listens at address
+    bool connect(const std::string& address);
+    void close();
+
+    bool is_open() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+
+    // Adds the newline. False when the peer is gone.
+    bool send_line(const std::string& line);
+    // Reads what has arrived into the buffer, for a socket poll() reported readable.
+    // False on end of stream or error.
+    bool receive();
+    // Takes the next complete line out of the buffer, false when there is none yet
+    bool next_line(std::string& line);
+    // Blocks until a whole line arrived, false when the peer is gone
+    bool read_line(std::string& line);
+
+    // Listening socket for address, -1 on failure. A stale Unix socket file is replaced.
+    static int listen(const std::string& address);
+    // Next connection of a listening socket, closed when accept fails
+    static LineSocket accept(int listen_fd);
+    // Closes a socket from listen() and removes its Unix socket file
+    static void close_listener(int listen_fd, const std::string& address);
+
+private:
+    int fd_ = -1;
+    std::string buffer; // Received bytes not yet returned as lines
+};
+
+#endif // LINESOCKET_H
@@ -0,0 +1,73 @@
+#ifndef LYRICSLAYER_H
+#define LYRICSLAYER_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GlyphAtlas.h"
+#include "Hash.h"
+#include "Rect.h"
+
+using Eigen::Vector3f;
+
+struct LyricsStyle {
+    std::string font_path; // Empty: built-in pixel font
+    int size = 0; // Font size in output pixels, 0: 52 per 1080 rows
+    Vector3f color = Vector3f(232.0f, 213.0f, 242.0f) / 255.0f;
+    float glow_radius = -1.0f; // Standard deviation in output pixels, < 0: 6 per 1080 rows
+};
+
+// Caption assembled from the glyph sprites, kept by a render context while it stays on screen
+struct CaptionImage {
+    int index = -1; // Caption in the image, -1: none yet
+    Rect rect; // Output pixels covered
+    std::vector<float> core; // Alpha of the text
+    std::vector<float> glow; // Alpha of the glow, already brightened and capped
+};
+
+// Timed captions drawn over the finished frames, centered near the bottom. Every glyph of
+// the lyrics is rasterized once into a GlyphAtlas when the file is loaded, a caption is
+// assembled from it the first time a render context shows it, and each frame only blends
+// the caption's rectangle. One caption per line of the file:
+//
+//   12.189 Oh cube,            seconds, on the clock of the keyframes
+//   [00:15.54]rocky little cube.   or an LRC time tag
+//   20.5                       no text: clear
+//
+// A caption stays until the next one and wraps at spaces when it is wider than the frame.
+class LyricsLayer
+{
+public:
+    // width and height of the output frame (upscaled)
+    LyricsLayer(const std::string& path, const LyricsStyle& style, int width, int height);
+
+    bool empty() const { return captions.empty(); }
+    // Caption shown at time, -1 for none
+    int caption_at(float time) const;
+    // Blends the caption shown at time into the 8 bit RGB frame. image caches the last caption.
+    void draw(float time, CaptionImage& image, uint8_t* rgb) const;
+    // Adds what the caption at time looks like, nothing when none is shown
+    void add_to_hash(Fnv1a& hash, float time) const;
+
+private:
+    struct Caption {
+        float time;
+        std::u32string text; // Empty: no caption
+    };
+
+    bool load(const std::string& path);
+    void build(int index, CaptionImage& image) const;
+    std::vector<std::u32string> wrap(const std::u32string& text) const;
+    int text_width(const std::u32string& text) const;
+
+    std::vector<Caption> captions; // Sorted by time
+    LyricsStyle style;
+    int width;
+    int height;
+    Vector3f glow_color;
+    GlyphAtlas atlas;
+    uint64_t font_checksum = 0; // Of the font file contents, when the atlas reads it
+};
+
+#endif // LYRICSLAYER_H
@@ -0,0 +1,84 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Stages timed by PROFILE_SCOPE, also the columns of the per frame CSV
+enum class Stage : uint8_t {
+    Frame,     // Scene::render_frame, one whole frame on its render thread
+    Keyframes, // Animator::evaluate
+    Project,   // Camera::convert_to_lines
+    Mask,      // ImageGenerator::getMask, nested in DrawLines
+    DrawLines,
+    DrawPoint,
+    Composite, // Blending, 8 bit conversion and upscale
+    Lyrics,    // Caption drawn over the frame
+    Convert,   // RGB to YUV of the Y4M output, on the writer thread
+    SaveBmp,   // On the writer thread
+    Write,     // Y4M stream write, on the writer thread
+};
+constexpr int STAGE_COUNT = 11;
+
+// Scoped stage timers. Every thread records into its own ring buffer, so recording
+// takes no locks and shares no cache lines. The buffers are only read by write_trace and
+// write_frame_csv, which must run after rendering is done.
+// Recording is off until enable() is called. Without PLATONIC_PROFILING the macros below
+// compile to nothing.
+class Profiler
+{
+public:
+#ifdef PLATONIC_PROFILING
+    static constexpr bool compiled_in = true;
+#else
+    static constexpr bool compiled_in = false;
+#endif
+
+    static void enable();
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    // Frame the following scopes of this thread belong to, -1 for none
+    static void set_frame(int frame);
+    static void set_thread_name(const char* name);
+
+    // Chrome trace event JSON, open in chrome://tracing or ui.perfetto.dev
+    static bool write_trace(const std::string& path);
+    // Milliseconds per frame and stage. Nested stages are counted in their parents too.
+    static bool write_frame_csv(const std::string& path);
+
+    static uint64_t now_ns();
+    static void record(Stage stage, uint64_t start_ns, uint64_t end_ns);
+
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage) : stage(stage), start_ns(enabled() ? now_ns() : 0) {}
+        ~Scope() {
+            if (start_ns != 0) record(stage, start_ns, now_ns());
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Stage stage;
+        uint64_t start_ns; // 0 when recording was off
+    };
+
+private:
+    static std::atomic<bool> active;
+};
+
+#ifdef PLATONIC_PROFILING
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage) Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+#define PROFILE_FRAME(frame) Profiler::set_frame(frame)
+#define PROFILE_THREAD(name) Profiler::set_thread_name(name)
+#else
+#define PROFILE_SCOPE(stage) ((void)0)
+#define PROFILE_FRAME(frame) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,33 @@
+#ifndef RECT_H
+#define RECT_H
+
+#include <algorithm>
+
+// Half-open pixel rectangle [x0, x1) x [y0, y1), empty when x0 >= x1 or y0 >= y1
+struct Rect {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+
+    // Grows to cover the inclusive pixel bounds [min_x, max_x] x [min_y, max_y]
+    void add(int min_x, int max_x, int min_y, int max_y) {
+        if (min_x > max_x || min_y > max_y) return;
+        if (empty()) {
+            *this = Rect{min_x, min_y, max_x + 1, max_y + 1};
+            return;
+        }
+        x0 = std::min(x0, min_x);
+        y0 = std::min(y0, min_y);
+        x1 = std::max(x1, max_x + 1);
+        y1 = std::max(y1, max_y + 1);
+    }
+
+    void add(const Rect& other) {
+        if (!other.empty()) add(other.x0, other.x1 - 1, other.y0, other.y1 - 1);
+    }
+};
+
+#endif // RECT_H
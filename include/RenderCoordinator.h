@@ -0,0 +1,64 @@
+#ifndef RENDERCOORDINATOR_H
+#define RENDERCOORDINATOR_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LineSocket.h"
+#include "Scene.h"
+
+// Hands out the frames of one scene to worker processes (RenderWorker) on this machine.
+// Units are sized by the estimated frame cost and get smaller as the work runs out. A
+// worker without work takes the back half of the largest unit still being rendered, and
+// the frames of a worker that disconnects are handed out again. One line per message:
+//
+//   worker                       coordinator
+//   HELLO <frames>               OK | ERROR <reason>
+//   NEXT                         UNIT <id> <first> <end> | DONE (held back while there is nothing to hand out)
+//   CLAIM <id> <next> <count>    RANGE <first> <end>
+//
+// CLAIM reports the frames before next as written and asks for up to count more frames
+// of the unit. An empty RANGE ends the unit, its end may have moved down by a steal.
+class RenderCoordinator
+{
+public:
+    RenderCoordinator(Scene& scene, std::string address);
+
+    // Serves until every frame is written, false when the socket cannot be opened
+    bool run();
+
+private:
+    struct Worker {
+        int id = 0;
+        LineSocket socket;
+        bool ready = false; // Sent a matching HELLO
+        bool waiting = false; // Sent NEXT, no reply yet
+        int unit = -1; // Current unit, -1: none
+        int next = 0; // Frames of the unit before next are written
+        int claimed = 0; // Frames before claimed are being rendered
+        int end = 0;
+    };
+
+    void handle(Worker& worker, const std::string& line);
+    void assign(Worker& worker);
+    bool steal(Worker& thief, int& first, int& end);
+    void disconnect(Worker& worker);
+    double cost(int first, int end) const;
+    double pending_cost() const;
+    int split_at(int first, int end, double target) const;
+    void print_progress();
+
+    Scene& scene;
+    std::string address;
+    std::vector<double> prefix; // Prefix sums of the frame costs
+    int total_frames = 0;
+    int frames_done = 0;
+    int next_unit = 0;
+    int next_worker = 1;
+    std::deque<std::pair<int, int>> pending; // Frame ranges not handed out yet
+    std::vector<std::unique_ptr<Worker>> workers;
+};
+
+#endif // RENDERCOORDINATOR_H
@@ -0,0 +1,30 @@
+#ifndef RENDERWORKER_H
+#define RENDERWORKER_H
+
+#include <string>
+#include "LineSocket.h"
+#include "Scene.h"
+
+// Renders the frame units a RenderCoordinator hands out until it reports that every frame
+// is done. The scene is loaded once, each unit is one render() whose end grows with every
+// claim of a few more frames.
+class RenderWorker
+{
+public:
+    RenderWorker(Scene& scene, std::string address);
+
+    // False when the coordinator cannot be reached, rejects the scene or goes away
+    bool run();
+
+private:
+    bool connect();
+    bool render_unit(int unit, int first);
+    bool request(const std::string& line, std::string& reply);
+
+    Scene& scene;
+    std::string address;
+    LineSocket socket;
+    int frames_rendered = 0;
+};
+
+#endif // RENDERWORKER_H
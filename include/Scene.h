@@ -4,28 +4,154 @@
 #include <vector>
 #include "Animator.h"
 #include "KeyframeCollection.h"
+#include "Compositor.h"
+#include "FrameWriter.h"
+#include "FrameSink.h"
+#include "FrameCache.h"
+#include "Timeline.h"
+#include "LyricsLayer.h"
+#include <functional>
 #include <string>
+#include <fstream>
+#include <memory>
 
 
+// Everything one worker needs to render a frame on its own
+struct RenderContext {
+    std::vector<Animator> animators; // Private copies, they hold the per frame buffers
+    std::vector<Layer> layers; // Views on the animator alpha buffers
+    std::vector<AnimatorState> states; // Evaluated state of the frame being rendered
+    std::vector<uint8_t> frame; // Composite of the current layers
+    bool frame_valid = false;
+    Rect frame_rect; // Union of the layer rectangles in frame, background outside
+    CaptionImage caption; // Last caption drawn, the frame itself never holds text
+    // Statistics
+    int layers_rendered = 0;
+    int layers_reused = 0;
+    int frames_composed = 0;
+    int frames_reused = 0;
+};
+
 class Scene {
 public:
+    // Called when the next frame to render is past the end of the frame range, with the
+    // frames before written on disk. Returns the new end, at most next ends the render.
+    using RangeExtender = std::function<int(int next, int written)>;
+
     Scene(std::string filename);
+    // render() and finish()
     void animate();
+    // Renders all frames, false when there is nothing to render. The last frames may
+    // still be queued for writing afterwards.
+    bool render();
+    // Waits until all frames are written, prints the statistics and encodes the video
+    // with ffmpeg. Can run on another thread while the next scene renders.
+    // A partial render (frame range or shard) is not encoded.
+    void finish();
+    // Audio cut and ffmpeg encode of all frames in img_path, e.g. after the shards finished
+    void encode();
+    int get_frame_count() const { return frame_count; }
+    // Frames of the whole animation
+    int get_total_frame_count() { return static_cast<int>(prepare().size()); }
+    // Whether finish() encodes after rendering all frames, on by default
+    void set_encode(bool enabled) { encode_enabled = enabled; }
+    // Whether finish() prints the statistics, on by default. Off, they add up over the
+    // renders until print_summary().
+    void set_summary(bool enabled) { summary_enabled = enabled; }
+    void print_summary();
     void set_debug_mode(bool mode);
+    void set_render_settings(const RenderSettings& settings);
+    // Stream frames as Y4M to a file, a FIFO or "-" (stdout) instead of writing BMPs
+    void set_y4m_output(const std::string& path);
+    // Render only the frames first..end-1, end < 0 renders up to the last frame.
+    // Frame numbers and noise stay those of the whole animation.
+    void set_frame_range(int first, int end);
+    // Lets render() continue past the end of the frame range, e.g. while a coordinator
+    // hands out more frames. Called from one thread at a time, empty to turn it off.
+    void set_range_extender(RangeExtender extend) { extend_range = std::move(extend); }
+    // Render shard index of count contiguous shards with about the same estimated cost.
+    // Every process computes the same split, so the shards cover each frame once.
+    void set_shard(int index, int count);
+    // Frame ranges [first, end) that can look different from the same frames of previous,
+    // a scene loaded from an earlier version of the same files. Only the keyframes are
+    // compared, a different animator count or first frame time changes every frame.
+    std::vector<std::pair<int, int>> changed_frames(Scene& previous);
+    // Deletes the BMP frames first..end-1, e.g. frames past the end of a shorter animation
+    void remove_frames(int first, int end);
+    const std::vector<std::string>& get_keyframe_paths() const { return keyframe_paths; }
+    const std::string& get_lyrics_path() const { return lyrics_path; } // Empty without lyrics
+    // Estimated relative render cost of every frame, see estimate_frame_costs
+    std::vector<double> frame_costs();
+    // Reuse finished frames from a directory shared across runs and scenes
+    void set_frame_cache(const std::string& directory);
+    // Evaluates all channels of all animators at every frame time into a Timeline file.
+    // Does nothing when the file already matches the keyframe files.
+    bool bake(const std::string& path);
+    // Render from a baked Timeline instead of the keyframes, ignored when it is out of date
+    void set_timeline(const std::string& path);
 
 private:
     std::vector<Animator> animators;
-    float get_animation_start_time() const;
-    float get_animation_end_time() const;
-    void save_image(const int& frame_number, const std::vector<Vector3f>& screen);
+    // From the timeline when one is used, otherwise from the keyframes
+    float get_animation_start_time();
+    float get_animation_end_time();
+    std::vector<float> get_frame_times(); // Empty when the animation has no frames
+    const std::vector<float>& prepare();
+    void load_keyframes(); // Parses the keyframe files once, when first needed
+    uint64_t keyframe_checksum() const;
+    bool timeline_matches(const Timeline& baked, uint64_t checksum) const;
+    bool use_timeline();
+    void load_options(std::ifstream& file, const std::string& path);
+    void create_contexts(int count);
+    void write_summary(std::ostream& out);
+    void render_frame(RenderContext& context, FrameWriter& writer, int frame_number, float time);
+    uint64_t frame_key(const RenderContext& context, float time) const;
+    std::vector<double> estimate_frame_costs(const std::vector<float>& frame_times);
+    static std::vector<int> split_by_cost(const std::vector<double>& costs, int count);
     int fps;
     int width;
     int height;
     int upscale_factor;
     Vector3f backgroundColor;
     std::string img_path;
+    std::string y4m_path; // Empty: BMP frames in img_path
+    std::vector<std::string> keyframe_paths; // One per animator
+    std::string timeline_path;
+    Timeline timeline; // Mapped while rendering, the animators read from it
+    bool timeline_active = false; // The timeline matched, frame times and channels come from it
+    bool keyframes_loaded = false;
     bool debug_mode = false;
     uint32_t random_seed = 42;
+    RenderSettings render_settings;
+    std::shared_ptr<FalloffCache> falloff_cache; // Glow tables shared by all animators
+    int frames_in_flight = 1; // Frames rendered at once, 0 = one per thread
+    int writer_queue = 4; // Finished frames that may wait for the disk
+    Compositor compositor;
+    std::vector<RenderContext> contexts; // One per worker
+    std::unique_ptr<FrameSink> sink; // Alive from render() to finish()
+    std::unique_ptr<FrameWriter> writer;
+    int frame_count = 0; // Frames rendered by the last render()
+    bool prepared = false;
+    std::vector<float> prepared_frame_times; // Set by prepare()
+    int first_frame = 0;
+    int end_frame = -1;
+    int shard_index = 0;
+    int shard_count = 0; // 0: no sharding
+    bool partial = false; // The last render() left out frames
+    bool encode_enabled = true;
+    bool summary_enabled = true;
+    RangeExtender extend_range;
+    // Statistics of the renders since the last summary
+    FrameWriter::Stats writer_totals;
+    int layers_rendered = 0;
+    int layers_reused = 0;
+    int frames_composed = 0;
+    int frames_reused = 0;
+    std::string lyrics_path;
+    LyricsStyle lyrics_style;
+    std::shared_ptr<const LyricsLayer> lyrics; // Read only, shared by all contexts
+    std::unique_ptr<FrameCache> frame_cache;
+    std::vector<uint64_t> frames_to_store; // Cache key per frame, 0 when the frame came from the cache
 
 };
 
@@ -0,0 +1,40 @@
+#ifndef SCENEWATCHER_H
+#define SCENEWATCHER_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Scene.h"
+
+// Renders a scene, then watches scene.txt and the keyframe files with inotify. After an
+// edit the scene is loaded again and only the frames whose keyframes changed are
+// rendered and written, see Scene::changed_frames. An edit of scene.txt or of the
+// lyrics renders everything. Nothing is encoded, run --encode when done.
+class SceneWatcher
+{
+public:
+    explicit SceneWatcher(std::string path);
+    ~SceneWatcher();
+
+    void set_frame_cache(const std::string& directory) { frame_cache_dir = directory; }
+
+    // Runs until interrupted, false when the scene or the watches cannot be set up
+    bool run();
+
+private:
+    std::unique_ptr<Scene> load();
+    bool add_watches();
+    // Blocks until a watched file changed and no more events came for a moment
+    bool wait_for_change();
+    void update();
+    void render(const std::vector<std::pair<int, int>>& ranges);
+
+    std::string path;
+    std::string frame_cache_dir;
+    std::unique_ptr<Scene> scene;
+    std::string scene_text; // scene.txt and the lyrics as scene was loaded from them
+    int inotify_fd = -1;
+};
+
+#endif // SCENEWATCHER_H
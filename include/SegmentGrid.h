@@ -0,0 +1,41 @@
+#ifndef SEGMENTGRID_H
+#define SEGMENTGRID_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include "Line.h"
+#include "LineSet.h"
+
+using Eigen::Vector2f;
+
+// Uniform screen-space grid over the lines of a LineSet.
+// Every cell stores the lines that can be the nearest line for some point inside that cell,
+// so a nearest-line query only has to look at a handful of lines instead of the whole path.
+class SegmentGrid
+{
+public:
+    SegmentGrid();
+
+    void build(const LineSet& lineSet, int cell_size, float margin);
+    void clear();
+    SegmentHit nearest(const LineSet& lineSet, const Vector2f& point) const;
+    int run(int x, int x_end, int y, const int*& begin, const int*& end) const;
+    bool empty() const { return cols == 0 || rows == 0; }
+    int originX() const { return (int)origin.x(); }
+    int originY() const { return (int)origin.y(); }
+    int cellSize() const { return cell_size; }
+
+private:
+    int column(float x) const;
+    int row(float y) const;
+
+    Vector2f origin;
+    int cell_size;
+    int cols;
+    int rows;
+    std::vector<int> cell_start; // Offsets into cell_lines, cols*rows + 1 entries
+    std::vector<int> cell_lines; // Candidate line indices per cell, ascending
+    std::vector<int> all_lines; // Candidates for points outside the grid
+};
+
+#endif // SEGMENTGRID_H
@@ -0,0 +1,43 @@
+#ifndef SPANMASK_H
+#define SPANMASK_H
+
+#include <vector>
+#include <cstddef>
+
+// Half-open pixel interval [x0, x1) on one row
+struct Span {
+    int x0;
+    int x1;
+};
+
+// Screen coverage stored as merged spans per row.
+// Every covered pixel appears exactly once, no matter how many rectangles cover it.
+// The row storage is kept between frames so refilling the mask does not allocate.
+class SpanMask
+{
+public:
+    SpanMask();
+
+    void reset(int width, int height);
+    void addRect(int min_x, int max_x, int min_y, int max_y); // Inclusive bounds, clipped to the screen
+    void merge();
+
+    int firstRow() const { return first_row; }
+    int lastRow() const { return last_row; }
+    int minX() const { return min_x; }
+    int maxX() const { return max_x; }
+    bool empty() const { return first_row > last_row; }
+    const std::vector<Span>& row(int y) const { return rows[y]; }
+    size_t pixelCount() const;
+
+private:
+    int width;
+    int height;
+    int first_row;
+    int last_row;
+    int min_x;
+    int max_x;
+    std::vector<std::vector<Span>> rows;
+};
+
+#endif // SPANMASK_H
@@ -0,0 +1,46 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CompiledTrack.h"
+#include "MappedFile.h"
+
+// Baked keyframe channels of a scene (see Scene::bake), memory mapped for reading.
+// Layout: Header, the frame times, then one table per animator with one row per frame
+// and one column per Channel. All values are native endian 32 bit floats.
+class Timeline
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t channel_count;
+        uint32_t animator_count;
+        uint32_t frame_count;
+        int32_t fps;
+        uint64_t checksum; // Of the keyframe files the table was evaluated from
+    };
+
+    // tables[animator] holds frame_times.size() rows of CHANNEL_COUNT values
+    static bool write(const std::string& path, uint64_t checksum, int fps,
+                      const std::vector<float>& frame_times, const std::vector<std::vector<float>>& tables);
+
+    // False when the file is missing, of another version or of the wrong size
+    bool open(const std::string& path);
+
+    const Header& header() const { return *static_cast<const Header*>(file.data()); }
+    int frame_count() const { return header().frame_count; }
+    int animator_count() const { return header().animator_count; }
+    const float* frame_times() const;
+    const float* table(int animator) const;
+    const float* row(int animator, int frame) const { return table(animator) + static_cast<size_t>(frame) * CHANNEL_COUNT; }
+
+private:
+    MappedFile file;
+};
+
+#endif // TIMELINE_H
@@ -1,51 +1,217 @@
 #include "Animator.h"
+#include "Profiler.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
+#include <cmath>
+#include <iterator>
 
 Animator::Animator(std::string name, Vector3f color, Camera cam, ImageGenerator imgGen, Object object, int fps)
     : name(name), color(color), camera(cam), imageGenerator(imgGen), object(object), fps(fps) {
-    std::random_device rd;
-    gen = std::mt19937(rd());
-    dist = std::normal_distribution<float>(0.0f, 1.0f);
 }
 
 Animator::Animator() {
-    std::random_device rd;
-    gen = std::mt19937(rd());
-    dist = std::normal_distribution<float>(0.0f, 1.0f);
 }
 
 void Animator::set_debug_mode(bool mode) {
     debug_mode = mode;
     imageGenerator.set_debug_mode(mode);
+    has_last_state = false;
 }
 
-void Animator::render_frame(float time) {
-    // KeyframeCollection currentKeyframe = get_keyframe(time, InterpolationType::Linear);
+void Animator::set_render_settings(const RenderSettings& settings) {
+    imageGenerator.set_render_settings(settings);
+    has_last_state = false;
+}
 
-    // Apply keyframe to object copy
-    object.setPosition(keyframeSet.get_object_position(time), keyframeSet.get_r(time), keyframeSet.get_phi(time));
-    object.setRotation(keyframeSet.get_object_rotation_axis(time), keyframeSet.get_object_rotation_angle(time));
-    object.setScale(keyframeSet.get_object_scale(time) * Vector3f(1.0f, 1.0f, 1.0f));
-    float x_err = dist(gen) * keyframeSet.get_cam_shift_err(time) * 0.05f;
-    float y_err = dist(gen) * keyframeSet.get_cam_shift_err(time) * 0.05f;
-    float shear_err = dist(gen) * keyframeSet.get_cam_shear_err(time) * 0.05f;
-    float x_offset_err = dist(gen) * keyframeSet.get_obj_shift_err(time) * 0.05f;
-    float y_offset_err = dist(gen) * keyframeSet.get_obj_shift_err(time) * 0.05f;
+void Animator::set_falloff_cache(const std::shared_ptr<FalloffCache>& cache) {
+    imageGenerator.set_falloff_cache(cache);
+}
 
+void Animator::set_noise(uint64_t seed, uint32_t stream) {
+    noise = CounterNoise(seed, stream);
+}
 
-    camera.set_error(shear_err, x_err, y_err, x_offset_err, y_offset_err);
-    camera.set_proj_matrix();
+void Animator::add_to_hash(Fnv1a& hash) const {
+    hash.add(color.x());
+    hash.add(color.y());
+    hash.add(color.z());
+    hash.add(static_cast<uint64_t>(object.points.size()));
+    for (const auto& point : object.points) {
+        hash.add(point.x());
+        hash.add(point.y());
+        hash.add(point.z());
+    }
+}
 
-    // Generate lines and render
-    LineSet lineSet = camera.convert_to_lines(object, keyframeSet.get_t(time), keyframeSet.get_length(time));
+std::array<float, 20> AnimatorState::values() const {
+    return {
+        t, length, decay_length, glow_length, point_glow_length,
+        position.x(), position.y(), position.z(), r, phi,
+        rotation_axis.x(), rotation_axis.y(), rotation_axis.z(), rotation_angle, scale,
+        shear_err, x_err, y_err, x_offset_err, y_offset_err
+    };
+}
+
+void add_to_hash(Fnv1a& hash, const AnimatorState& state) {
+    for (float value : state.values()) {
+        hash.add(value);
+    }
+}
+
+// The layer stays empty when the point glow is off and the path has no extent:
+// with scale 0 every vertex projects onto the same point, and with length 0 convert_to_lines
+// emits a single zero length line. Zero length lines have no finite distance to any pixel.
+bool Animator::draws_nothing(const AnimatorState& state) const {
+    if (state.point_glow_length > 0.00001f) return false; // Same threshold as drawPoint
+    if (state.scale == 0.0f) return true;
+    if (state.length == 0.0f) {
+        // Right below a vertex, rounding can still add one tiny line, same test as convert_to_lines
+        int k = std::floor(state.t * object.points.size());
+        float q = k * 1 / (float)object.points.size();
+        return !(q > state.t);
+    }
+    return false;
+}
+
+void Animator::build_activity(const std::vector<float>& frame_times) {
+    active_frames.clear();
+    for (size_t i = 0; i < frame_times.size(); ++i) {
+        float time = frame_times[i];
+        float channels[CHANNEL_COUNT];
+        sample(time, i, channels);
+        AnimatorState state;
+        state.t = channels[static_cast<int>(Channel::T)];
+        state.length = channels[static_cast<int>(Channel::Length)];
+        state.point_glow_length = channels[static_cast<int>(Channel::PointGlowLength)];
+        state.scale = channels[static_cast<int>(Channel::Scale)];
+        if (draws_nothing(state)) continue;
+        if (!active_frames.empty() && active_frames.back().second == (int)i) {
+            active_frames.back().second++;
+        } else {
+            active_frames.push_back({(int)i, (int)i + 1});
+        }
+    }
+    has_activity = true;
+}
+
+bool Animator::is_active(int frame) const {
+    if (!has_activity) return true;
+    auto it = std::upper_bound(active_frames.begin(), active_frames.end(), frame,
+        [](int f, const std::pair<int, int>& interval) { return f < interval.first; });
+    return it != active_frames.begin() && frame < std::prev(it)->second;
+}
+
+void Animator::set_timeline(const float* table, int frame_count) {
+    baked = table;
+    baked_frames = frame_count;
+}
+
+void Animator::sample_keyframes(float time, float* channels) {
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        channels[c] = keyframeSet.get(static_cast<Channel>(c), time);
+    }
+}
+
+void Animator::sample_keyframes(const std::vector<float>& times, float* table) {
+    std::vector<float> column(times.size());
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        keyframeSet.tracks[c].values(times.data(), column.data(), times.size());
+        for (size_t i = 0; i < times.size(); ++i) {
+            table[i * CHANNEL_COUNT + c] = column[i];
+        }
+    }
+}
+
+void Animator::sample(float time, int frame, float* channels) {
+    if (baked && frame >= 0 && frame < baked_frames) {
+        const float* row = baked + static_cast<size_t>(frame) * CHANNEL_COUNT;
+        std::copy(row, row + CHANNEL_COUNT, channels);
+    } else {
+        sample_keyframes(time, channels);
+    }
+}
+
+AnimatorState Animator::evaluate(float time, int frame) {
+    PROFILE_SCOPE(Stage::Keyframes);
+    AnimatorState state;
+    if (!is_active(frame)) {
+        return state; // The empty state, equal for all culled frames
+    }
+    float channels[CHANNEL_COUNT];
+    sample(time, frame, channels);
+    auto value = [&channels](Channel channel) { return channels[static_cast<int>(channel)]; };
+    state.t = value(Channel::T);
+    state.length = value(Channel::Length);
+    state.decay_length = value(Channel::DecayLength);
+    state.glow_length = value(Channel::GlowLength);
+    state.point_glow_length = value(Channel::PointGlowLength);
+    state.position = Vector3f(value(Channel::PositionX), value(Channel::PositionY), value(Channel::PositionZ));
+    state.r = value(Channel::R);
+    state.phi = value(Channel::Phi);
+    state.rotation_axis = Vector3f(value(Channel::RotationX), value(Channel::RotationY), value(Channel::RotationZ)).normalized();
+    state.rotation_angle = value(Channel::RotationAngle);
+    state.scale = value(Channel::Scale);
+
+    // One noise sample per error term, fixed sample index so the frame alone decides the shake
+    float cam_shift_err = value(Channel::CamShiftErr);
+    float cam_shear_err = value(Channel::CamShearErr);
+    float obj_shift_err = value(Channel::ObjShiftErr);
+    state.x_err = noise.normal(frame, 0) * cam_shift_err * 0.05f;
+    state.y_err = noise.normal(frame, 1) * cam_shift_err * 0.05f;
+    state.shear_err = noise.normal(frame, 2) * cam_shear_err * 0.05f;
+    state.x_offset_err = noise.normal(frame, 3) * obj_shift_err * 0.05f;
+    state.y_offset_err = noise.normal(frame, 4) * obj_shift_err * 0.05f;
+    return state;
+}
+
+bool Animator::render(const AnimatorState& state) {
+    if (has_last_state && state == last_state) {
+        return false;
+    }
+    last_state = state;
+    has_last_state = true;
 
     imageGenerator.clear();
-    imageGenerator.drawLines(lineSet, keyframeSet.get_decay_length(time), keyframeSet.get_glow_length(time));
-    imageGenerator.drawPoint(lineSet.getStartPoint(), keyframeSet.get_point_glow_length(time));
+    if (draws_nothing(state)) {
+        return true;
+    }
+
+    // Generate lines and render
+    LineSet lineSet = project(state);
+
+    imageGenerator.drawLines(lineSet, state.decay_length, state.glow_length);
+    imageGenerator.drawPoint(lineSet.getStartPoint(), state.point_glow_length);
+    return true;
+}
+
+LineSet Animator::project(const AnimatorState& state) {
+    // Apply keyframe to object copy
+    object.setPosition(state.position, state.r, state.phi);
+    object.setRotation(state.rotation_axis, state.rotation_angle);
+    object.setScale(state.scale * Vector3f(1.0f, 1.0f, 1.0f));
+
+    camera.set_error(state.shear_err, state.x_err, state.y_err, state.x_offset_err, state.y_offset_err);
+    camera.set_proj_matrix();
+    return camera.convert_to_lines(object, state.t, state.length);
+}
+
+float Animator::estimate_cost(const AnimatorState& state) {
+    if (draws_nothing(state)) {
+        return 0.0f;
+    }
+    LineSet lineSet = project(state);
+    float path_length = 0.0f;
+    for (const auto& line : lineSet.lines) {
+        path_length += (line.endPoint - line.startPoint).norm();
+    }
+    return imageGenerator.support_area(path_length, static_cast<int>(lineSet.lines.size()), state.point_glow_length);
+}
+
+bool Animator::render_frame(float time, int frame) {
+    return render(evaluate(time, frame));
 }
 
 // void Animator::animate(const std::string& filename) const {
@@ -183,4 +349,5 @@ float Animator::get_end_time() const {
 
 void Animator::clear() {
     imageGenerator.clear();
+    has_last_state = false;
 }
\ No newline at end of file
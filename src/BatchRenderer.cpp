@@ -0,0 +1,98 @@
+#include "BatchRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+BatchRenderer::BatchRenderer(std::vector<std::string> scene_names)
+    : scene_names(std::move(scene_names)) {}
+
+BatchRenderer::~BatchRenderer() {
+    wait_for_finish();
+}
+
+bool BatchRenderer::run() {
+    auto batch_start = Clock::now();
+    timings.clear();
+    timings.reserve(scene_names.size());
+
+    for (const auto& name : scene_names) {
+        std::cout << "Scene " << timings.size() + 1 << "/" << scene_names.size() << ": " << name << std::endl;
+        SceneTiming timing;
+        timing.name = name;
+
+        auto start = Clock::now();
+        auto scene = std::make_unique<Scene>(name);
+        if (!frame_cache_dir.empty()) {
+            scene->set_frame_cache(frame_cache_dir);
+        }
+        timing.load_seconds = seconds_since(start);
+
+        start = Clock::now();
+        timing.ok = scene->render();
+        timing.render_seconds = seconds_since(start);
+        timing.frames = scene->get_frame_count();
+
+        // Only one scene is finished at a time, so at most two scenes hold frame buffers
+        wait_for_finish();
+        timings.push_back(timing);
+        if (!timing.ok) {
+            continue;
+        }
+        finishing = std::move(scene);
+        size_t index = timings.size() - 1;
+        finish_thread = std::thread([this, index] {
+            auto finish_start = Clock::now();
+            finishing->finish();
+            timings[index].finish_seconds = seconds_since(finish_start);
+        });
+    }
+    wait_for_finish();
+    total_seconds = seconds_since(batch_start);
+
+    for (const auto& timing : timings) {
+        if (!timing.ok) return false;
+    }
+    return true;
+}
+
+void BatchRenderer::wait_for_finish() {
+    if (finish_thread.joinable()) {
+        finish_thread.join();
+    }
+    finishing.reset();
+}
+
+void BatchRenderer::print_summary(std::ostream& out) const {
+    double busy_seconds = 0;
+    int total_frames = 0;
+    out << "Batch summary:" << std::endl;
+    out << "  " << std::left << std::setw(16) << "scene" << std::right
+        << std::setw(8) << "frames" << std::setw(10) << "load s" << std::setw(10) << "render s"
+        << std::setw(10) << "finish s" << std::setw(10) << "fps" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (const auto& timing : timings) {
+        out << "  " << std::left << std::setw(16) << timing.name << std::right;
+        if (!timing.ok) {
+            out << std::setw(8) << "-" << std::setw(10) << timing.load_seconds << "  nothing rendered" << std::endl;
+            continue;
+        }
+        double fps = timing.render_seconds > 0 ? timing.frames / timing.render_seconds : 0;
+        out << std::setw(8) << timing.frames << std::setw(10) << timing.load_seconds
+            << std::setw(10) << timing.render_seconds << std::setw(10) << timing.finish_seconds
+            << std::setw(10) << fps << std::endl;
+        busy_seconds += timing.load_seconds + timing.render_seconds + timing.finish_seconds;
+        total_frames += timing.frames;
+    }
+    out << "  " << total_frames << " frames in " << total_seconds << " s, "
+        << std::max(0.0, busy_seconds - total_seconds) << " s of finishing overlapped with rendering" << std::endl;
+    out << std::defaultfloat;
+}
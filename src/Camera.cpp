@@ -1,4 +1,6 @@
 #include "Camera.h"
+#include "Profiler.h"
+#include <algorithm>
 #include <iostream>
 
 Camera::Camera() : Camera(100, 100, true) {}
@@ -15,7 +17,9 @@ Camera::Camera(int screenWidth, int screenHeight, bool orthonormal) {
     shear_error = 0.0f;
     x_scale_error = 0.0f;
     y_scale_error = 0.0f;
-    projectionMatrix = MatrixXf::Zero(2, 3);
+    x_offset_error = 0.0f;
+    y_offset_error = 0.0f;
+    projectionMatrix.setZero();
     ortho = orthonormal;
     set_proj_matrix();
 
@@ -24,20 +28,26 @@ Camera::Camera(int screenWidth, int screenHeight, bool orthonormal) {
 void Camera::set_proj_matrix(){
     if(ortho) {
         // Set up orthonormal projection matrix
-        projectionMatrix = MatrixXf({{1.0f, shear_error, x_scale_error},
-                            {0.0f, 1.0f, y_scale_error}});
+        projectionMatrix << 1.0f, shear_error, x_scale_error,
+                            0.0f, 1.0f, y_scale_error;
     }else {
         // Not implemented
         throw std::runtime_error("Non-orthonormal projection not implemented");
     }
 }
 
+Vector2f Camera::apply_projection(const Vector3f& point) const {
+    // Summed column by column like the MatrixXf product this replaced, a fixed size
+    // product rounds differently
+    return projectionMatrix.col(0) * point.x() + projectionMatrix.col(1) * point.y() + projectionMatrix.col(2) * point.z();
+}
+
 std::vector<Vector2f> Camera::getScreenPos(std::vector<Object> &objects) {
     std::vector<Vector2f> screenPositions;
     for (auto &object : objects) {
         // Project each point of the object onto the screen
         for (size_t i = 0; i < object.points.size(); ++i) {
-            Vector2f point = projectionMatrix * (object.rotation_matrix * object.scale_matrix * object.points[i] + object.position + Vector3f(x_offset_error, y_offset_error, 0));
+            Vector2f point = apply_projection(object.rotation_matrix * object.scale_matrix * object.points[i] + object.position + Vector3f(x_offset_error, y_offset_error, 0));
             point.x() = (point.x() / W) * w + w / 2; // Normalize and scale to viewport
             point.y() = (point.y() / H) * h + h / 2; // Normalize and scale to viewport
             screenPositions.push_back(point);
@@ -49,7 +59,7 @@ std::vector<Vector2f> Camera::getScreenPos(std::vector<Object> &objects) {
 std::vector<Vector2f> Camera::getScreenPos(std::vector<Vector3f> &points) {
     std::vector<Vector2f> screenPositions;
     for (const auto &point : points) {
-        Vector2f screenPoint = projectionMatrix * point;
+        Vector2f screenPoint = apply_projection(point);
         screenPoint.x() = (screenPoint.x() / W) * w + w / 2; // Normalize and scale to viewport
         screenPoint.y() = (screenPoint.y() / H) * h + h / 2; // Normalize and scale to viewport
         screenPositions.push_back(screenPoint);
@@ -57,37 +67,52 @@ std::vector<Vector2f> Camera::getScreenPos(std::vector<Vector3f> &points) {
     return screenPositions;
 }
 
-LineSet Camera::convert_to_lines(const Object& object) const {
+void Camera::project(const Object& object) {
+    // Rotation times scale computed once per object. Same operation order as
+    // get_screen_position otherwise, so both give the same positions bit for bit.
+    Eigen::Matrix3f model = object.rotation_matrix * object.scale_matrix;
+    Vector3f offset(x_offset_error, y_offset_error, 0);
+    Vector2f center(w / 2, h / 2);
+
+    projected_points.resize(object.points.size());
+    for (size_t i = 0; i < object.points.size(); ++i) {
+        Vector2f point = apply_projection(model * object.points[i] + object.position + offset);
+        projected_points[i] = Vector2f((point.x() / W) * w + center.x(), (point.y() / H) * h + center.y());
+    }
+}
+
+LineSet Camera::convert_to_lines(const Object& object) {
+    PROFILE_SCOPE(Stage::Project);
+    project(object);
     LineSet lineSet;
+    lineSet.lines.reserve(projected_points.size());
     // Convert the object's points into lines
-    for (size_t i = 0; i < object.points.size(); ++i) {
-        Vector2f start = projectionMatrix * (object.rotation_matrix * object.scale_matrix * object.points[i] + object.position + Vector3f(x_offset_error, y_offset_error, 0));
-        Vector2f end = projectionMatrix * (object.rotation_matrix * object.scale_matrix * object.points[(i + 1) % object.points.size()] + object.position + Vector3f(x_offset_error, y_offset_error, 0));
-        start.x() = (start.x() / W) * w + w / 2; // Normalize and scale to viewport
-        start.y() = (start.y() / H) * h + h / 2; // Normalize and scale to viewport
-        end.x() = (end.x() / W) * w + w / 2; // Normalize and scale to viewport
-        end.y() = (end.y() / H) * h + h / 2; // Normalize and scale to viewport
-        lineSet.addLine(Line(start, end));
+    for (size_t i = 0; i < projected_points.size(); ++i) {
+        lineSet.addLine(Line(projected_points[i], projected_points[(i + 1) % projected_points.size()]));
     }
     return lineSet;
 }
 
 Vector2f Camera::get_screen_position(const Vector3f& world_position, const Object& object) const {
-    Vector2f screen_position = projectionMatrix * (object.rotation_matrix * object.scale_matrix * world_position + object.position + Vector3f(x_offset_error, y_offset_error, 0));
+    Vector2f screen_position = apply_projection(object.rotation_matrix * object.scale_matrix * world_position + object.position + Vector3f(x_offset_error, y_offset_error, 0));
     screen_position.x() = (screen_position.x() / W) * w + w / 2; // Normalize and scale to viewport
     screen_position.y() = (screen_position.y() / H) * h + h / 2; // Normalize and scale to viewport
     return screen_position;
 }
 
-LineSet Camera::convert_to_lines(const Object& object, float start_t, float length) const {
+LineSet Camera::convert_to_lines(const Object& object, float start_t, float length) {
+    PROFILE_SCOPE(Stage::Project);
     // Make start_t mod 1
     
     LineSet lineSet;
     if(length >= 1.0f){
         length = 1.0f;
     }
+    project(object);
+    // One line per vertex passed, plus the partial edges at both ends
+    lineSet.lines.reserve(static_cast<size_t>(std::max(length, 0.0f) * object.points.size()) + 2);
     
-    Vector2f p_s = get_point(start_t, object);
+    Vector2f p_s = get_point(start_t);
 
     int k = std::floor(start_t * object.points.size());
     float q = k * 1 / (float)object.points.size();
@@ -95,25 +120,25 @@ LineSet Camera::convert_to_lines(const Object& object, float start_t, float leng
     // Paralizeable in the future
     while (q > start_t-length)
     {
-        Vector2f p_e = get_point(q, object);
+        Vector2f p_e = get_point(q);
         lineSet.addLine(Line(p_s, p_e));
         p_s = p_e;
         k--;
         q = k * 1 / (float)object.points.size();
     }
-    Vector2f p_e = get_point(start_t - length, object);
+    Vector2f p_e = get_point(start_t - length);
     lineSet.addLine(Line(p_s, p_e));
     return lineSet;
 }
 
-Vector2f Camera::get_point(float t, const Object &object) const
+Vector2f Camera::get_point(float t) const
 {
     float o = t - std::floor(t);
-    int l = static_cast<int>(o * object.points.size());
-    float m = 1 / (float)object.points.size();
+    int l = static_cast<int>(o * projected_points.size());
+    float m = 1 / (float)projected_points.size();
 
-    Vector2f v_s = get_screen_position(object.points[l], object);
-    Vector2f v_e = get_screen_position(object.points[(l + 1) % object.points.size()], object);
+    const Vector2f& v_s = projected_points[l];
+    const Vector2f& v_e = projected_points[(l + 1) % projected_points.size()];
 
     return v_s + (o - l * m) / m * (v_e - v_s);
 }
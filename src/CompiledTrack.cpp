@@ -0,0 +1,187 @@
+#include "CompiledTrack.h"
+#include "EasingCurves.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+TrackRule CompiledTrack::classify(const std::vector<Keyframe>& keyframes, float time, float default_value) {
+    TrackRule rule;
+    rule.value = default_value;
+    if (keyframes.empty()) return rule;
+
+    // First keyframe that contains the time, in storage order
+    for (size_t i = 0; i < keyframes.size(); ++i) {
+        const auto& kf = keyframes[i];
+        if (kf.start_time <= time && kf.end_time >= time) {
+            if (kf.start_time == kf.end_time) {
+                rule.value = kf.end_val; // Avoid division by zero
+                return rule;
+            }
+            float start_val = kf.start_val;
+            if (std::isnan(start_val)) {
+                // The first keyframe holds its own end value, the others start at the previous end
+                start_val = (i == 0) ? kf.end_val : keyframes[i - 1].end_val;
+            }
+            rule.kind = TrackRule::Interpolate;
+            rule.value = start_val;
+            rule.keyframe = i;
+            return rule;
+        }
+    }
+
+    // Between two keyframes hold the end value of the previous one
+    for (size_t i = 0; i < keyframes.size() - 1; ++i) {
+        if (keyframes[i].end_time < time && time < keyframes[i + 1].start_time) {
+            rule.value = keyframes[i].end_val;
+            return rule;
+        }
+    }
+
+    // Before the first keyframe, only when it has no explicit start value
+    if (time < keyframes.front().start_time && std::isnan(keyframes.front().start_val)) {
+        rule.value = keyframes.front().end_val;
+        return rule;
+    }
+
+    // After the last keyframe
+    if (time > keyframes.back().end_time) {
+        rule.value = keyframes.back().end_val;
+    }
+    return rule;
+}
+
+float CompiledTrack::evaluate(const TrackRule& rule, const std::vector<Keyframe>& keyframes, float time) {
+    if (rule.kind == TrackRule::Constant) return rule.value;
+    const Keyframe& kf = keyframes[rule.keyframe];
+    return rule.value + EasingCurves::apply((time - kf.start_time) / (kf.end_time - kf.start_time), kf.curve) * (kf.end_val - rule.value);
+}
+
+CompiledTrack CompiledTrack::compile(const std::vector<Keyframe>& keyframes, float default_value) {
+    CompiledTrack track;
+    track.default_value = default_value;
+
+    // NaN times never compare true, they cannot split a piece
+    for (const auto& kf : keyframes) {
+        if (!std::isnan(kf.start_time)) track.bounds.push_back(kf.start_time);
+        if (!std::isnan(kf.end_time)) track.bounds.push_back(kf.end_time);
+    }
+    std::sort(track.bounds.begin(), track.bounds.end());
+    track.bounds.erase(std::unique(track.bounds.begin(), track.bounds.end()), track.bounds.end());
+
+    const size_t n = track.bounds.size();
+    const float inf = std::numeric_limits<float>::infinity();
+    for (size_t piece = 0; piece < 2 * n + 1; ++piece) {
+        size_t k = piece / 2;
+        // Any time inside the piece takes the same branch
+        float sample = 0.0f;
+        bool empty = false;
+        if (piece % 2 == 1) {
+            sample = track.bounds[k];
+        } else if (n == 0) {
+            sample = 0.0f;
+        } else if (k == 0) {
+            sample = std::nextafter(track.bounds[0], -inf);
+            empty = !(sample < track.bounds[0]);
+        } else {
+            sample = std::nextafter(track.bounds[k - 1], inf);
+            empty = !(sample > track.bounds[k - 1]) || (k < n && !(sample < track.bounds[k]));
+        }
+
+        TrackRule rule;
+        rule.value = default_value;
+        if (!empty) rule = classify(keyframes, sample, default_value);
+
+        track.kind.push_back(rule.kind);
+        track.start_value.push_back(rule.value);
+        if (rule.kind == TrackRule::Interpolate) {
+            const Keyframe& kf = keyframes[rule.keyframe];
+            track.start_time.push_back(kf.start_time);
+            track.duration.push_back(kf.end_time - kf.start_time);
+            track.delta.push_back(kf.end_val - rule.value);
+            track.curve.push_back(kf.curve);
+        } else {
+            track.start_time.push_back(0.0f);
+            track.duration.push_back(1.0f);
+            track.delta.push_back(0.0f);
+            track.curve.push_back(KeyframeCurve::Linear);
+        }
+    }
+
+    track.limits.push_back(-inf);
+    track.limits.insert(track.limits.end(), track.bounds.begin(), track.bounds.end());
+    track.limits.push_back(inf);
+
+    track.constant_value = track.start_value[0];
+    for (size_t piece = 0; piece < track.kind.size(); ++piece) {
+        if (track.kind[piece] != TrackRule::Constant || !(track.start_value[piece] == track.constant_value)) {
+            track.constant = false;
+        }
+    }
+    return track;
+}
+
+size_t CompiledTrack::find(float time, size_t hint) const {
+    // The hint and its successor cover playback, everything else is a binary search
+    if (limits[hint] < time && time <= limits[hint + 1]) return hint;
+    if (hint + 2 < limits.size() && limits[hint + 1] < time && time <= limits[hint + 2]) return hint + 1;
+    return std::lower_bound(bounds.begin(), bounds.end(), time) - bounds.begin();
+}
+
+size_t CompiledTrack::piece(size_t k, float time) const {
+    return (k < bounds.size() && bounds[k] == time) ? 2 * k + 1 : 2 * k;
+}
+
+float CompiledTrack::evaluate_piece(size_t piece, float time) const {
+    if (kind[piece] == TrackRule::Constant) return start_value[piece];
+    return start_value[piece] + EasingCurves::apply((time - start_time[piece]) / duration[piece], curve[piece]) * delta[piece];
+}
+
+float CompiledTrack::value(float time) {
+    if (kind.empty() || std::isnan(time)) return default_value;
+    if (constant) return constant_value;
+    cursor = find(time, cursor);
+    return evaluate_piece(piece(cursor, time), time);
+}
+
+float CompiledTrack::value_at(float time) const {
+    if (kind.empty() || std::isnan(time)) return default_value;
+    if (constant) return constant_value;
+    size_t k = std::lower_bound(bounds.begin(), bounds.end(), time) - bounds.begin();
+    return evaluate_piece(piece(k, time), time);
+}
+
+void CompiledTrack::values(const float* times, float* out, size_t count) const {
+    size_t k = 0;
+    size_t i = 0;
+    while (i < count) {
+        if (kind.empty() || constant || std::isnan(times[i])) {
+            out[i] = value_at(times[i]);
+            ++i;
+            continue;
+        }
+        k = find(times[i], k);
+        size_t p = piece(k, times[i]);
+
+        // Extend the run while the times stay in the piece
+        size_t end = i + 1;
+        while (end < count && !std::isnan(times[end])) {
+            size_t next = find(times[end], k);
+            if (piece(next, times[end]) != p) break;
+            k = next;
+            ++end;
+        }
+
+        if (kind[p] == TrackRule::Constant) {
+            std::fill(out + i, out + end, start_value[p]);
+        } else {
+            for (size_t j = i; j < end; ++j) {
+                out[j] = (times[j] - start_time[p]) / duration[p];
+            }
+            EasingCurves::apply(out + i, out + i, end - i, curve[p]);
+            for (size_t j = i; j < end; ++j) {
+                out[j] = start_value[p] + out[j] * delta[p];
+            }
+        }
+        i = end;
+    }
+}
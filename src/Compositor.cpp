@@ -0,0 +1,92 @@
+#include "Compositor.h"
+#include <algorithm>
+
+Compositor::Compositor()
+    : width(0), height(0), upscale_factor(1), background(0.0f, 0.0f, 0.0f) {}
+
+Compositor::Compositor(int width, int height, int upscale_factor, const Vector3f& background)
+    : width(width), height(height), upscale_factor(upscale_factor), background(background) {}
+
+size_t Compositor::frame_size() const {
+    return static_cast<size_t>(width) * upscale_factor * static_cast<size_t>(height) * upscale_factor * 3;
+}
+
+Rect Compositor::full_frame() const {
+    return Rect{0, 0, width, height};
+}
+
+void Compositor::compose(const std::vector<Layer>& layers, uint8_t* rgb) const {
+    compose(layers, rgb, full_frame());
+}
+
+void Compositor::compose(const std::vector<Layer>& layers, uint8_t* rgb, const Rect& region) const {
+    const size_t upscaled_width = static_cast<size_t>(width) * upscale_factor;
+    const uint8_t background_rgb[3] = {
+        static_cast<uint8_t>(std::min(255.0f, background.x() * 255.0f)),
+        static_cast<uint8_t>(std::min(255.0f, background.y() * 255.0f)),
+        static_cast<uint8_t>(std::min(255.0f, background.z() * 255.0f))
+    };
+    auto put = [&](int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+        for (int dy = 0; dy < upscale_factor; ++dy) {
+            uint8_t* out = rgb + ((static_cast<size_t>(y) * upscale_factor + dy) * upscaled_width + static_cast<size_t>(x) * upscale_factor) * 3;
+            for (int dx = 0; dx < upscale_factor; ++dx) {
+                out[dx * 3 + 0] = r;
+                out[dx * 3 + 1] = g;
+                out[dx * 3 + 2] = b;
+            }
+        }
+    };
+
+    #pragma omp parallel
+    {
+        // Layers whose rectangle touches the current row. Alpha is zero outside a layer's
+        // rectangle, so skipping the other layers does not change any sum.
+        std::vector<const Layer*> row_layers;
+        row_layers.reserve(layers.size());
+
+        #pragma omp for
+        for (int y = region.y0; y < region.y1; ++y) {
+            row_layers.clear();
+            int covered_x0 = region.x1;
+            int covered_x1 = region.x0;
+            for (const Layer& layer : layers) {
+                if (layer.rect && (layer.rect->empty() || y < layer.rect->y0 || y >= layer.rect->y1)) continue;
+                row_layers.push_back(&layer);
+                covered_x0 = std::min(covered_x0, layer.rect ? std::max(layer.rect->x0, region.x0) : region.x0);
+                covered_x1 = std::max(covered_x1, layer.rect ? std::min(layer.rect->x1, region.x1) : region.x1);
+            }
+
+            for (int x = region.x0; x < region.x1; ++x) {
+                if (x < covered_x0 || x >= covered_x1) {
+                    put(x, y, background_rgb[0], background_rgb[1], background_rgb[2]);
+                    continue;
+                }
+                int l = y * width + x;
+
+                // Collect all contributions and the total alpha
+                float total_alpha = 0.0f;
+                Vector3f color_sum(0.0f, 0.0f, 0.0f);
+                for (const Layer* layer : row_layers) {
+                    total_alpha += layer->alpha[l];
+                    color_sum += layer->color * layer->alpha[l];
+                }
+
+                // Normalize and blend with background
+                Vector3f c;
+                if (total_alpha > 0.0f) {
+                    // Normalize the color by total alpha to avoid over-saturation
+                    Vector3f blended_color = color_sum / total_alpha;
+                    // Cap alpha at 1.0
+                    float final_alpha = std::min(1.0f, total_alpha);
+                    c = final_alpha * blended_color + (1.0f - final_alpha) * background;
+                } else {
+                    c = background;
+                }
+
+                put(x, y, static_cast<uint8_t>(std::min(255.0f, c.x() * 255.0f)),
+                          static_cast<uint8_t>(std::min(255.0f, c.y() * 255.0f)),
+                          static_cast<uint8_t>(std::min(255.0f, c.z() * 255.0f)));
+            }
+        }
+    }
+}
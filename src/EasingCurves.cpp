@@ -0,0 +1,174 @@
+#include "EasingCurves.h"
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Reference formulas. They mix double (M_PI, std::pow) and float on purpose:
+    // every rendered frame so far depends on exactly these roundings.
+    template <KeyframeCurve C> float reference(float t);
+
+    template <> float reference<KeyframeCurve::Linear>(float t) {
+        return t;
+    }
+    template <> float reference<KeyframeCurve::InSine>(float t) {
+        return 1 - std::cos((t * M_PI) / 2);
+    }
+    template <> float reference<KeyframeCurve::OutSine>(float t) {
+        return std::sin((t * M_PI) / 2);
+    }
+    template <> float reference<KeyframeCurve::InOutSine>(float t) {
+        return -0.5f * (std::cos(M_PI * t) - 1);
+    }
+    template <> float reference<KeyframeCurve::EaseInCubic>(float t) {
+        return t * t * t;
+    }
+    template <> float reference<KeyframeCurve::EaseOutCubic>(float t) {
+        return 1 - std::pow(1 - t, 3);
+    }
+    template <> float reference<KeyframeCurve::EaseInOutCubic>(float t) {
+        if (t < 0.5f) {
+            return 4 * t * t * t;
+        } else {
+            float f = ((2 * t) - 2);
+            return 0.5f * f * f * f + 1;
+        }
+    }
+    template <> float reference<KeyframeCurve::StepStart>(float t) {
+        return (t <= 0.0f) ? 0.0f : 1.0f;
+    }
+    template <> float reference<KeyframeCurve::StepMiddle>(float t) {
+        return (t < 0.5f) ? 0.0f : 1.0f;
+    }
+    template <> float reference<KeyframeCurve::StepEnd>(float t) {
+        return (t <= 1.0f) ? 0.0f : 1.0f;
+    }
+    template <> float reference<KeyframeCurve::InExpo>(float t) {
+        return (t == 0.0f) ? 0.0f : std::pow(2, 10 * (t - 1));
+    }
+    template <> float reference<KeyframeCurve::OutExpo>(float t) {
+        return (t == 1.0f) ? 1.0f : 1 - std::pow(2, -10 * t);
+    }
+    template <> float reference<KeyframeCurve::InOutExpo>(float t) {
+        if (t == 0.0f) return 0.0f;
+        if (t == 1.0f) return 1.0f;
+        if (t < 0.5f) return std::pow(2, 20 * t - 10) / 2;
+        return (2 - std::pow(2, -20 * t + 10)) / 2;
+    }
+    template <> float reference<KeyframeCurve::InCirc>(float t) {
+        return 1 - std::sqrt(1 - t * t);
+    }
+    template <> float reference<KeyframeCurve::OutCirc>(float t) {
+        return std::sqrt((2 - 1)*t);
+    }
+    template <> float reference<KeyframeCurve::InOutCirc>(float t) {
+        if (t < 0.5f) {
+            return (1 - std::sqrt(1 - 4 * (t * t))) / 2;
+        } else {
+            return (std::sqrt(-((2 * t) - 3) * ((2 * t) - 1)) + 1) / 2;
+        }
+    }
+    template <> float reference<KeyframeCurve::InOver>(float t) {
+        float s1 = 1.70158f;
+        return t * t * ((s1 + 1) * t - s1);
+    }
+    template <> float reference<KeyframeCurve::OutOver>(float t) {
+        float s2 = 1.70158f;
+        t = t - 1;
+        return t * t * ((s2 + 1) * t + s2) + 1;
+    }
+    template <> float reference<KeyframeCurve::InOutOver>(float t) {
+        float s3 = 1.70158f * 1.525f;
+        if (t < 0.5f) {
+            return (t * 2) * (t * 2) * ((s3 + 1) * (t * 2) - s3) / 2;
+        } else {
+            t = t * 2 - 2;
+            return (t * t * ((s3 + 1) * t + s3) + 2) / 2;
+        }
+    }
+    template <> float reference<KeyframeCurve::InElastic>(float t) {
+        float c4 = 10.75f;
+        float c5 = (2 * M_PI) / 3;
+        if (t == 0) return 0;
+        if (t == 1) return 1;
+        return -std::pow(2, 10 * (t - 1)) * std::sin((t*10-c4) * c5);
+    }
+    template <> float reference<KeyframeCurve::OutElastic>(float t) {
+        float c6 = 10.75f;
+        float c7 = (2 * M_PI) / 3;
+        if (t == 0) return 0;
+        if (t == 1) return 1;
+        return std::pow(2, -10 * t) * std::sin((t*10-c6) * c7) + 1;
+    }
+    template <> float reference<KeyframeCurve::InOutElastic>(float t) {
+        float c8 = 11.125f;
+        float c9 = (2 * M_PI) / 4.5;
+        if (t == 0) return 0;
+        if (t == 1) return 1;
+        if (t < 0.5f) {
+            return -(std::pow(2, 20 * t - 10) * std::sin((20 * t - c8) * c9)) / 2;
+        } else {
+            return (std::pow(2, -20 * t + 10) * std::sin((20 * t - c8) * c9)) / 2 + 1;
+        }
+    }
+
+    template <KeyframeCurve C>
+    void exact_batch(const float* t, float* out, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = reference<C>(t[i]);
+        }
+    }
+
+    struct Entry {
+        float (*scalar)(float);
+        EasingCurves::BatchFunction batch;
+    };
+
+    template <KeyframeCurve C>
+    constexpr Entry entry() {
+        return Entry{reference<C>, exact_batch<C>};
+    }
+
+    // In KeyframeCurve order
+    const Entry ENTRIES[] = {
+        entry<KeyframeCurve::Linear>(),
+        entry<KeyframeCurve::InSine>(),
+        entry<KeyframeCurve::OutSine>(),
+        entry<KeyframeCurve::InOutSine>(),
+        entry<KeyframeCurve::EaseInCubic>(),
+        entry<KeyframeCurve::EaseOutCubic>(),
+        entry<KeyframeCurve::EaseInOutCubic>(),
+        entry<KeyframeCurve::StepStart>(),
+        entry<KeyframeCurve::StepMiddle>(),
+        entry<KeyframeCurve::StepEnd>(),
+        entry<KeyframeCurve::InExpo>(),
+        entry<KeyframeCurve::OutExpo>(),
+        entry<KeyframeCurve::InOutExpo>(),
+        entry<KeyframeCurve::InCirc>(),
+        entry<KeyframeCurve::OutCirc>(),
+        entry<KeyframeCurve::InOutCirc>(),
+        entry<KeyframeCurve::InOver>(),
+        entry<KeyframeCurve::OutOver>(),
+        entry<KeyframeCurve::InOutOver>(),
+        entry<KeyframeCurve::InElastic>(),
+        entry<KeyframeCurve::OutElastic>(),
+        entry<KeyframeCurve::InOutElastic>(),
+    };
+    const size_t ENTRY_COUNT = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+
+    const Entry* find_entry(KeyframeCurve curve) {
+        size_t index = static_cast<size_t>(curve);
+        if (index >= ENTRY_COUNT) {
+            std::cerr << "Ease function not implemented yet" << std::endl;
+            return &ENTRIES[0]; // Fallback to linear if unknown
+        }
+        return &ENTRIES[index];
+    }
+}
+
+float EasingCurves::apply(float t, KeyframeCurve curve) {
+    return find_entry(curve)->scalar(t);
+}
+
+EasingCurves::BatchFunction EasingCurves::batch(KeyframeCurve curve) {
+    return find_entry(curve)->batch;
+}
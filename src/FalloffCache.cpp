@@ -0,0 +1,84 @@
+#include "FalloffCache.h"
+#include <cmath>
+
+namespace {
+    const float LINE_SAMPLES_PER_PIXEL = 32.0f;
+
+    // Same expression as the glow in ImageGenerator, so radial tables are exact
+    float falloff(float squaredDistance, float glow_length, float conversion_factor) {
+        return exp(-sqrt(squaredDistance)/glow_length/(conversion_factor));
+    }
+}
+
+float FalloffTable::at_distance(float squared_distance) const {
+    float d = std::sqrt(squared_distance) * samples_per_pixel;
+    if (!(d < (float)(values.size() - 1))) {
+        return falloff(squared_distance, glow_length, conversion_factor);
+    }
+    int i = (int)d;
+    float frac = d - i;
+    return values[i] + frac * (values[i + 1] - values[i]);
+}
+
+std::shared_ptr<const FalloffTable> FalloffCache::radial(float glow_length, float conversion_factor, int max_squared_distance) {
+    Key key(Kind::Radial, glow_length, conversion_factor, (float)max_squared_distance);
+    std::shared_ptr<const FalloffTable> table = lookup(key);
+    if (table) return table;
+
+    auto new_table = std::make_shared<FalloffTable>();
+    new_table->glow_length = glow_length;
+    new_table->conversion_factor = conversion_factor;
+    new_table->extent = (float)max_squared_distance;
+    new_table->values.resize(max_squared_distance + 1);
+    for (int i = 0; i <= max_squared_distance; ++i) {
+        new_table->values[i] = falloff((float)i, glow_length, conversion_factor);
+    }
+    insert(key, new_table);
+    return new_table;
+}
+
+std::shared_ptr<const FalloffTable> FalloffCache::line(float glow_length, float conversion_factor, float max_distance) {
+    Key key(Kind::Line, glow_length, conversion_factor, max_distance);
+    std::shared_ptr<const FalloffTable> table = lookup(key);
+    if (table) return table;
+
+    auto new_table = std::make_shared<FalloffTable>();
+    new_table->glow_length = glow_length;
+    new_table->conversion_factor = conversion_factor;
+    new_table->extent = max_distance;
+    new_table->samples_per_pixel = LINE_SAMPLES_PER_PIXEL;
+    int samples = (int)std::ceil(max_distance * LINE_SAMPLES_PER_PIXEL) + 2;
+    new_table->values.resize(samples);
+    for (int i = 0; i < samples; ++i) {
+        float d = i / LINE_SAMPLES_PER_PIXEL;
+        new_table->values[i] = falloff(d * d, glow_length, conversion_factor);
+    }
+    insert(key, new_table);
+    return new_table;
+}
+
+size_t FalloffCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::shared_ptr<const FalloffTable> FalloffCache::lookup(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) return nullptr;
+    it->second.last_use = ++use_counter;
+    return it->second.table;
+}
+
+void FalloffCache::insert(const Key& key, const std::shared_ptr<const FalloffTable>& table) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.size() >= MAX_ENTRIES) {
+        // Evict the least recently used table, animated glow lengths only pass through
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->second.last_use < oldest->second.last_use) oldest = it;
+        }
+        entries.erase(oldest);
+    }
+    entries[key] = Entry{table, ++use_counter};
+}
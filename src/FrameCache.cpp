@@ -0,0 +1,78 @@
+#include "FrameCache.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[4] = {'P', 'A', 'F', 'C'};
+
+    struct Header {
+        char magic[4];
+        uint64_t key;
+        uint64_t size;
+    };
+}
+
+FrameCache::FrameCache(const std::string& directory) : directory(directory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Error creating frame cache directory " << directory << ": " << error.message() << std::endl;
+    }
+}
+
+std::string FrameCache::path(uint64_t key) const {
+    std::stringstream ss;
+    ss << directory << "/" << std::hex << std::setfill('0') << std::setw(16) << key << ".frame";
+    return ss.str();
+}
+
+bool FrameCache::load(uint64_t key, std::vector<uint8_t>& frame) {
+    std::ifstream file(path(key), std::ios::binary);
+    Header header;
+    bool ok = file.is_open()
+        && file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        && std::equal(MAGIC, MAGIC + 4, header.magic)
+        && header.key == key
+        && header.size == frame.size()
+        && file.read(reinterpret_cast<char*>(frame.data()), frame.size());
+    (ok ? hits : misses)++;
+    return ok;
+}
+
+void FrameCache::store(uint64_t key, const std::vector<uint8_t>& frame) {
+    std::string final_path = path(key);
+    std::stringstream tmp;
+    tmp << final_path << ".tmp." << getpid() << "." << std::this_thread::get_id();
+
+    Header header;
+    std::copy(MAGIC, MAGIC + 4, header.magic);
+    header.key = key;
+    header.size = frame.size();
+    {
+        std::ofstream file(tmp.str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+        if (!file) {
+            std::cerr << "Error writing frame cache entry " << tmp.str() << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp.str(), final_path, error);
+    if (error) {
+        std::cerr << "Error storing frame cache entry " << final_path << ": " << error.message() << std::endl;
+        std::filesystem::remove(tmp.str(), error);
+        return;
+    }
+    stored++;
+}
+
+void FrameCache::print_summary(std::ostream& out) const {
+    out << "Frame cache: " << hits << " hits, " << misses << " misses, " << stored << " stored in " << directory << std::endl;
+}
@@ -0,0 +1,117 @@
+#include "FrameSink.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "save_bmp.h"
+
+BmpSink::BmpSink(const std::string& directory, int width, int height)
+    : directory(directory), width(width), height(height) {}
+
+std::string BmpSink::frame_path(const std::string& directory, int frame_number) {
+    std::stringstream ss;
+    ss << directory << "/frame_" << std::setfill('0') << std::setw(5) << frame_number << ".bmp";
+    return ss.str();
+}
+
+bool BmpSink::write(int frame_number, const std::vector<uint8_t>& rgb) {
+    std::string path = frame_path(directory, frame_number);
+    PROFILE_SCOPE(Stage::SaveBmp);
+    enum save_bmp_result result = save_bmp(path.c_str(), width, height, rgb.data());
+    // Check the result of saving the BMP file
+    if (result != SAVE_BMP_SUCCESS) {
+        std::cerr << "!!!Error saving image: " << result << std::endl;
+        std::cerr << save_bmp_str_result(result) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Y4mSink::Y4mSink(const std::string& path, int width, int height, int fps)
+    : path(path), width(width), height(height), fps(fps) {
+    yuv.resize(static_cast<size_t>(width) * height + 2 * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2));
+}
+
+Y4mSink::~Y4mSink() {
+    close();
+}
+
+bool Y4mSink::write(int /*frame_number*/, const std::vector<uint8_t>& rgb) {
+    if (failed) return false;
+    if (!file) {
+        // Opened on the first frame: opening a FIFO blocks until the reader shows up
+        file = path == "-" ? stdout : fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Error opening Y4M output: " << path << std::endl;
+            failed = true;
+            return false;
+        }
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XYSCSS=420JPEG XCOLORRANGE=LIMITED\n", width, height, fps);
+    }
+
+    {
+        PROFILE_SCOPE(Stage::Convert);
+        rgb_to_yuv420(rgb.data(), width, height, yuv.data());
+    }
+    PROFILE_SCOPE(Stage::Write);
+    if (fputs("FRAME\n", file) < 0 || fwrite(yuv.data(), 1, yuv.size(), file) != yuv.size()) {
+        std::cerr << "Error writing Y4M output: " << path << std::endl;
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+void Y4mSink::close() {
+    if (!file) return;
+    if (file == stdout) {
+        fflush(file);
+    } else {
+        fclose(file);
+    }
+    file = nullptr;
+}
+
+// BT.601 limited range in 8.8 fixed point, the same matrix ffmpeg uses for rgb24 -> yuv420p.
+// Plain loops over arrays with no branches so the compiler vectorizes them.
+void rgb_to_yuv420(const uint8_t* rgb, int width, int height, uint8_t* yuv) {
+    const int chroma_width = (width + 1) / 2;
+    const int chroma_height = (height + 1) / 2;
+    uint8_t* y_plane = yuv;
+    uint8_t* u_plane = yuv + static_cast<size_t>(width) * height;
+    uint8_t* v_plane = u_plane + static_cast<size_t>(chroma_width) * chroma_height;
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rgb + static_cast<size_t>(y) * width * 3;
+        uint8_t* out = y_plane + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            int r = row[3 * x], g = row[3 * x + 1], b = row[3 * x + 2];
+            out[x] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    for (int cy = 0; cy < chroma_height; ++cy) {
+        // Odd sizes repeat the last row / column
+        const uint8_t* row0 = rgb + static_cast<size_t>(2 * cy) * width * 3;
+        const uint8_t* row1 = rgb + static_cast<size_t>(std::min(2 * cy + 1, height - 1)) * width * 3;
+        uint8_t* u_out = u_plane + static_cast<size_t>(cy) * chroma_width;
+        uint8_t* v_out = v_plane + static_cast<size_t>(cy) * chroma_width;
+        const int pairs = width / 2;
+        for (int cx = 0; cx < pairs; ++cx) {
+            int r = row0[6 * cx] + row0[6 * cx + 3] + row1[6 * cx] + row1[6 * cx + 3];
+            int g = row0[6 * cx + 1] + row0[6 * cx + 4] + row1[6 * cx + 1] + row1[6 * cx + 4];
+            int b = row0[6 * cx + 2] + row0[6 * cx + 5] + row1[6 * cx + 2] + row1[6 * cx + 5];
+            u_out[cx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+            v_out[cx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+        }
+        if (pairs < chroma_width) {
+            int x = 2 * pairs;
+            int r = 2 * (row0[3 * x] + row1[3 * x]);
+            int g = 2 * (row0[3 * x + 1] + row1[3 * x + 1]);
+            int b = 2 * (row0[3 * x + 2] + row1[3 * x + 2]);
+            u_out[pairs] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+            v_out[pairs] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+        }
+    }
+}
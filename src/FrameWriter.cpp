@@ -0,0 +1,116 @@
+#include "FrameWriter.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+namespace {
+    double seconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+FrameWriter::FrameWriter(size_t frame_size, int queue_size, int first_frame, WriteFunction write)
+    : write(write), queue_size(std::max(1, queue_size)), next_frame(first_frame) {
+    stats.queue_size = this->queue_size;
+    buffers.resize(this->queue_size, std::vector<uint8_t>(frame_size));
+    for (auto& buffer : buffers) {
+        free_buffers.push_back(&buffer);
+    }
+    thread = std::thread(&FrameWriter::run, this);
+}
+
+FrameWriter::~FrameWriter() {
+    finish();
+}
+
+std::vector<uint8_t>* FrameWriter::acquire(int frame_number) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto admitted = [&]() { return frame_number < next_frame + queue_size && !free_buffers.empty(); };
+    if (!admitted()) {
+        auto start = std::chrono::steady_clock::now();
+        buffer_free.wait(lock, admitted);
+        stats.stall_seconds += seconds_since(start);
+    }
+    std::vector<uint8_t>* buffer = free_buffers.back();
+    free_buffers.pop_back();
+    return buffer;
+}
+
+void FrameWriter::submit(int frame_number, std::vector<uint8_t>* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[frame_number] = buffer;
+        stats.max_depth = std::max(stats.max_depth, pending.size());
+        stats.depth_sum += pending.size();
+    }
+    frame_ready.notify_one();
+}
+
+void FrameWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    frame_ready.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void FrameWriter::run() {
+    PROFILE_THREAD("frame writer");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        frame_ready.wait(lock, [&]() { return done || pending.count(next_frame) > 0; });
+        auto it = pending.find(next_frame);
+        if (it == pending.end()) {
+            // Done and the next frame never came: nothing left that can be written in order
+            if (!pending.empty()) {
+                next_frame = pending.begin()->first;
+                continue;
+            }
+            break;
+        }
+        std::vector<uint8_t>* buffer = it->second;
+        pending.erase(it);
+
+        // Write without holding the lock, the renderer keeps submitting
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        PROFILE_FRAME(next_frame);
+        write(next_frame, *buffer);
+        double elapsed = seconds_since(start);
+        lock.lock();
+
+        stats.write_seconds += elapsed;
+        stats.frames_written++;
+        next_frame++;
+        free_buffers.push_back(buffer);
+        buffer_free.notify_all();
+    }
+}
+
+int FrameWriter::written_until() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return next_frame;
+}
+
+void FrameWriter::add_stats(Stats& totals) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    totals.frames_written += stats.frames_written;
+    totals.queue_size = std::max(totals.queue_size, stats.queue_size);
+    totals.max_depth = std::max(totals.max_depth, stats.max_depth);
+    totals.depth_sum += stats.depth_sum;
+    totals.stall_seconds += stats.stall_seconds;
+    totals.write_seconds += stats.write_seconds;
+}
+
+void FrameWriter::print_summary(std::ostream& out, const Stats& stats) {
+    double average_depth = stats.frames_written > 0 ? (double)stats.depth_sum / stats.frames_written : 0.0;
+    out << std::fixed << std::setprecision(2)
+        << "Frame writer: " << stats.frames_written << " frames, queue size " << stats.queue_size
+        << ", max depth " << stats.max_depth << ", average depth " << average_depth
+        << ", write time " << stats.write_seconds << "s, renderer stalled " << stats.stall_seconds << "s"
+        << std::defaultfloat << std::endl;
+}
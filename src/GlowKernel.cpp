@@ -0,0 +1,198 @@
+#include "GlowKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GLOW_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+GlowKernel::GlowKernel()
+    : lineSet(nullptr), glow_length(0.5f), decay_length(0.25f), conversion_factor(1.0f), falloff(nullptr), simd(avx2Supported()) {}
+
+bool GlowKernel::avx2Supported() {
+#ifdef GLOW_KERNEL_X86
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void GlowKernel::setLines(const LineSet& lineSet) {
+    this->lineSet = &lineSet;
+    size_t n = lineSet.lines.size();
+    start_x.resize(n);
+    start_y.resize(n);
+    end_x.resize(n);
+    end_y.resize(n);
+    direction_x.resize(n);
+    direction_y.resize(n);
+    squared_length.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Line& line = lineSet.lines[i];
+        Vector2f direction = line.endPoint - line.startPoint;
+        start_x[i] = line.startPoint.x();
+        start_y[i] = line.startPoint.y();
+        end_x[i] = line.endPoint.x();
+        end_y[i] = line.endPoint.y();
+        direction_x[i] = direction.x();
+        direction_y[i] = direction.y();
+        squared_length[i] = direction.squaredNorm();
+    }
+}
+
+void GlowKernel::setGlow(float glow_length, float decay_length, float conversion_factor, const FalloffTable& falloff) {
+    this->glow_length = glow_length;
+    this->decay_length = decay_length;
+    this->conversion_factor = conversion_factor;
+    this->falloff = &falloff;
+}
+
+void GlowKernel::shadeRun(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const {
+    if (simd) {
+        shadeRunAvx2(begin, end, y, x0, x1, alpha);
+    } else {
+        shadeRunScalar(begin, end, y, x0, x1, alpha);
+    }
+}
+
+void GlowKernel::shadeRunScalar(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const {
+    const std::vector<Line>& lines = lineSet->lines;
+    for (int x = x0; x < x1; ++x) {
+        Vector2f point((float)x, (float)y);
+        SegmentHit hit;
+        for (const int* c = begin; c != end; ++c) {
+            float t = lines[*c].get_t(point);
+            float dist = lines[*c].squaredDistance(point, t);
+            if (dist < hit.squared_distance) {
+                hit.squared_distance = dist;
+                hit.index = *c;
+                hit.t = t;
+            }
+        }
+        float t = lineSet->get_t(hit);
+        float new_alpha = falloff->at_distance(hit.squared_distance)*exp(-t/decay_length/conversion_factor*100.0f);
+        alpha[x] = std::max(alpha[x], new_alpha);
+    }
+}
+
+#ifdef GLOW_KERNEL_X86
+
+namespace {
+    // exp(x) for 8 floats, Cephes expf reduction and polynomial.
+    // Maximum relative error is about 2 ulp (< 2.4e-7) for x in [-87.3, 88.7].
+    // Results below that range flush to zero, NaN is passed through.
+    __attribute__((target("avx2")))
+    __m256 exp256(__m256 x) {
+        const __m256 hi = _mm256_set1_ps(88.3762626647949f);
+        const __m256 lo = _mm256_set1_ps(-88.3762626647949f);
+        const __m256 input = x;
+        __m256 nan_mask = _mm256_cmp_ps(x, x, _CMP_UNORD_Q);
+        __m256 over_mask = _mm256_cmp_ps(x, hi, _CMP_GT_OQ);
+        __m256 under_mask = _mm256_cmp_ps(x, lo, _CMP_LT_OQ);
+        x = _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+
+        // x = n*ln(2) + r with |r| <= ln(2)/2
+        __m256 fx = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)), _mm256_set1_ps(0.5f));
+        fx = _mm256_floor_ps(fx);
+        x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(0.693359375f)));
+        x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(-2.12194440e-4f)));
+
+        __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+        y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.3981999507e-3f));
+        y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(8.3334519073e-3f));
+        y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(4.1665795894e-2f));
+        y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.6666665459e-1f));
+        y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(5.0000001201e-1f));
+        y = _mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(x, x)), x);
+        y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+
+        // Scale by 2^n through the exponent bits
+        __m256i n = _mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127));
+        __m256 pow2n = _mm256_castsi256_ps(_mm256_slli_epi32(n, 23));
+        y = _mm256_mul_ps(y, pow2n);
+
+        y = _mm256_andnot_ps(under_mask, y);
+        y = _mm256_blendv_ps(y, _mm256_set1_ps(std::numeric_limits<float>::infinity()), over_mask);
+        return _mm256_blendv_ps(y, input, nan_mask);
+    }
+}
+
+// No FMA on purpose: the distance terms are rounded exactly like the scalar path,
+// so both paths pick the same nearest line.
+__attribute__((target("avx2")))
+void GlowKernel::shadeRunAvx2(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const {
+    const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 py = _mm256_set1_ps((float)y);
+    const __m256 count = _mm256_set1_ps((float)lineSet->lines.size());
+    const __m256 glow = _mm256_set1_ps(glow_length);
+    const __m256 decay = _mm256_set1_ps(decay_length);
+    const __m256 conversion = _mm256_set1_ps(conversion_factor);
+    const __m256 hundred = _mm256_set1_ps(100.0f);
+
+    for (int x = x0; x < x1; x += 8) {
+        __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), lane);
+        __m256 best_d = _mm256_set1_ps(std::numeric_limits<float>::max());
+        __m256 best_t = best_d;
+        __m256 best_i = _mm256_set1_ps(-1.0f);
+
+        for (const int* c = begin; c != end; ++c) {
+            int i = *c;
+            __m256 sx = _mm256_set1_ps(start_x[i]);
+            __m256 sy = _mm256_set1_ps(start_y[i]);
+            __m256 dx = _mm256_set1_ps(direction_x[i]);
+            __m256 dy = _mm256_set1_ps(direction_y[i]);
+
+            // Line::get_t
+            __m256 diff_x = _mm256_sub_ps(px, sx);
+            __m256 diff_y = _mm256_sub_ps(py, sy);
+            __m256 t = _mm256_add_ps(_mm256_mul_ps(diff_x, dx), _mm256_mul_ps(diff_y, dy));
+            t = _mm256_div_ps(t, _mm256_set1_ps(squared_length[i]));
+
+            // Line::squaredDistance
+            __m256 ox = _mm256_sub_ps(px, _mm256_add_ps(sx, _mm256_mul_ps(t, dx)));
+            __m256 oy = _mm256_sub_ps(py, _mm256_add_ps(sy, _mm256_mul_ps(t, dy)));
+            __m256 before = _mm256_cmp_ps(t, zero, _CMP_LT_OQ);
+            __m256 after = _mm256_cmp_ps(t, one, _CMP_GT_OQ);
+            ox = _mm256_blendv_ps(ox, diff_x, before);
+            oy = _mm256_blendv_ps(oy, diff_y, before);
+            ox = _mm256_blendv_ps(ox, _mm256_sub_ps(px, _mm256_set1_ps(end_x[i])), after);
+            oy = _mm256_blendv_ps(oy, _mm256_sub_ps(py, _mm256_set1_ps(end_y[i])), after);
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy));
+
+            __m256 closer = _mm256_cmp_ps(d, best_d, _CMP_LT_OQ);
+            best_d = _mm256_blendv_ps(best_d, d, closer);
+            best_t = _mm256_blendv_ps(best_t, t, closer);
+            best_i = _mm256_blendv_ps(best_i, _mm256_set1_ps((float)i), closer);
+        }
+
+        // LineSet::get_t(const SegmentHit&)
+        __m256 clamped = _mm256_blendv_ps(best_t, zero, _mm256_cmp_ps(best_t, zero, _CMP_LT_OQ));
+        clamped = _mm256_blendv_ps(clamped, one, _mm256_cmp_ps(best_t, one, _CMP_GT_OQ));
+        __m256 path_t = _mm256_div_ps(_mm256_add_ps(best_i, clamped), count);
+
+        // exp(-d/glow/conversion) * exp(-t/decay/conversion*100) as a single exp
+        __m256 a = _mm256_div_ps(_mm256_div_ps(_mm256_xor_ps(_mm256_sqrt_ps(best_d), sign), glow), conversion);
+        __m256 b = _mm256_mul_ps(_mm256_div_ps(_mm256_div_ps(_mm256_xor_ps(path_t, sign), decay), conversion), hundred);
+        __m256 value = exp256(_mm256_add_ps(a, b));
+
+        __m256i store_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(x1 - x), lane_index);
+        __m256 old = _mm256_maskload_ps(alpha + x, store_mask);
+        // maxps returns its second operand for NaN, so NaN values leave alpha untouched
+        _mm256_maskstore_ps(alpha + x, store_mask, _mm256_max_ps(value, old));
+    }
+}
+
+#else
+
+void GlowKernel::shadeRunAvx2(const int* begin, const int* end, int y, int x0, int x1, float* alpha) const {
+    shadeRunScalar(begin, end, y, x0, x1, alpha);
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "GlyphAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#ifdef PLATONIC_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+namespace {
+    // 5x7 pixel font for ASCII 32..126, one byte per row from the top, bit 4 is the left column
+    const uint8_t BUILTIN_GLYPHS[95][7] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // !
+        {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00}, // "
+        {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}, // #
+        {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, // $
+        {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+        {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, // &
+        {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // '
+        {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+        {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+        {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, // *
+        {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // +
+        {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ,
+        {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+        {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+        {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+        {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+        {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+        {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+        {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+        {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+        {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+        {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}, // ;
+        {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // <
+        {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // =
+        {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // >
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // ?
+        {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, // @
+        {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // A
+        {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+        {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+        {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+        {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+        {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+        {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+        {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+        {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+        {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+        {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+        {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+        {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+        {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+        {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+        {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+        {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+        {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+        {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+        {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+        {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}, // [
+        {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, // backslash
+        {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}, // ]
+        {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00}, // ^
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // _
+        {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00}, // `
+        {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F}, // a
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E}, // b
+        {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E}, // c
+        {0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F}, // d
+        {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E}, // e
+        {0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08}, // f
+        {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // g
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11}, // h
+        {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E}, // i
+        {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C}, // j
+        {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12}, // k
+        {0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // l
+        {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11}, // m
+        {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11}, // n
+        {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E}, // o
+        {0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10}, // p
+        {0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01}, // q
+        {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10}, // r
+        {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E}, // s
+        {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06}, // t
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D}, // u
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04}, // v
+        {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A}, // w
+        {0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11}, // x
+        {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // y
+        {0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F}, // z
+        {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02}, // {
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // |
+        {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08}, // }
+        {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00}, // ~
+    };
+    const int BUILTIN_WIDTH = 5;
+    const int BUILTIN_HEIGHT = 7;
+
+    // Built-in replacements for the typographic characters lyrics often use
+    char builtin_character(char32_t c) {
+        if (c >= 32 && c <= 126) return static_cast<char>(c);
+        switch (c) {
+            case U'\u00A0': case U'\u2800': return ' ';
+            case U'\u2018': case U'\u2019': case U'\u00B4': return '\'';
+            case U'\u201C': case U'\u201D': return '"';
+            case U'\u2013': case U'\u2014': return '-';
+            case U'\u2026': return '.';
+            default: return '?';
+        }
+    }
+}
+
+struct GlyphAtlas::FreeTypeFont {
+#ifdef PLATONIC_FREETYPE
+    FT_Library library = nullptr;
+    FT_Face face = nullptr;
+    ~FreeTypeFont() {
+        if (face) FT_Done_Face(face);
+        if (library) FT_Done_FreeType(library);
+    }
+#endif
+};
+
+GlyphAtlas::GlyphAtlas() = default;
+GlyphAtlas::~GlyphAtlas() = default;
+GlyphAtlas::GlyphAtlas(GlyphAtlas&&) noexcept = default;
+GlyphAtlas& GlyphAtlas::operator=(GlyphAtlas&&) noexcept = default;
+
+GlyphAtlas::GlyphAtlas(const std::string& font_path, int size, float glow_radius)
+    : glow_radius(std::max(0.0f, glow_radius)) {
+    size = std::max(1, size);
+    if (!font_path.empty()) {
+#ifdef PLATONIC_FREETYPE
+        auto font = std::make_unique<FreeTypeFont>();
+        if (FT_Init_FreeType(&font->library) == 0 && FT_New_Face(font->library, font_path.c_str(), 0, &font->face) == 0
+            && FT_Set_Pixel_Sizes(font->face, 0, size) == 0) {
+            line_height_ = static_cast<int>((font->face->size->metrics.height + 63) >> 6);
+            freetype = std::move(font);
+        } else {
+            std::cerr << "Could not load the font " << font_path << ", using the built-in font" << std::endl;
+        }
+#else
+        std::cerr << "Built without FreeType, using the built-in font instead of " << font_path << std::endl;
+#endif
+    }
+    if (!freetype) {
+        // The 7 rows of a glyph and a gap row fill the em
+        builtin_scale = std::max(1, static_cast<int>(std::lround(size / 8.0f)));
+        line_height_ = 10 * builtin_scale;
+    }
+
+    margin = static_cast<int>(std::ceil(3.0f * this->glow_radius));
+    kernel.assign(2 * margin + 1, 1.0f);
+    if (margin > 0) {
+        float sum = 0.0f;
+        for (int i = -margin; i <= margin; ++i) {
+            kernel[i + margin] = std::exp(-0.5f * i * i / (this->glow_radius * this->glow_radius));
+            sum += kernel[i + margin];
+        }
+        for (float& weight : kernel) weight /= sum;
+    }
+}
+
+void GlyphAtlas::add(const std::u32string& text) {
+    // Stands in for characters the font does not have
+    std::u32string characters = text + U'?';
+    for (char32_t c : characters) {
+        if (sprites.count(c)) continue;
+        Coverage coverage;
+        if (rasterize(c, coverage)) {
+            insert(c, coverage);
+        }
+    }
+}
+
+const GlyphSprite* GlyphAtlas::find(char32_t c) const {
+    auto it = sprites.find(c);
+    if (it == sprites.end()) {
+        it = sprites.find(U'?');
+    }
+    return it == sprites.end() ? nullptr : &it->second;
+}
+
+bool GlyphAtlas::rasterize(char32_t c, Coverage& coverage) const {
+    if (!freetype) {
+        rasterize_builtin(c, coverage);
+        return true;
+    }
+#ifdef PLATONIC_FREETYPE
+    FT_Face face = freetype->face;
+    FT_UInt index = FT_Get_Char_Index(face, c);
+    if (index == 0 || FT_Load_Glyph(face, index, FT_LOAD_RENDER) != 0) {
+        return false;
+    }
+    const FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+    coverage.width = static_cast<int>(bitmap.width);
+    coverage.height = static_cast<int>(bitmap.rows);
+    coverage.left = slot->bitmap_left;
+    coverage.top = -slot->bitmap_top;
+    coverage.advance = static_cast<int>((slot->advance.x + 32) >> 6);
+    coverage.values.resize(static_cast<size_t>(coverage.width) * coverage.height);
+    for (int y = 0; y < coverage.height; ++y) {
+        const unsigned char* row = bitmap.buffer + static_cast<ptrdiff_t>(y) * bitmap.pitch;
+        for (int x = 0; x < coverage.width; ++x) {
+            float value = bitmap.pixel_mode == FT_PIXEL_MODE_MONO
+                ? ((row[x >> 3] >> (7 - (x & 7))) & 1)
+                : row[x] / 255.0f;
+            coverage.values[static_cast<size_t>(y) * coverage.width + x] = value;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void GlyphAtlas::rasterize_builtin(char32_t c, Coverage& coverage) const {
+    const uint8_t* rows = BUILTIN_GLYPHS[builtin_character(c) - 32];
+    int scale = builtin_scale;
+    coverage.width = BUILTIN_WIDTH * scale;
+    coverage.height = BUILTIN_HEIGHT * scale;
+    coverage.left = 0;
+    coverage.top = -BUILTIN_HEIGHT * scale;
+    coverage.advance = (BUILTIN_WIDTH + 1) * scale;
+    coverage.values.assign(static_cast<size_t>(coverage.width) * coverage.height, 0.0f);
+    for (int y = 0; y < coverage.height; ++y) {
+        for (int x = 0; x < coverage.width; ++x) {
+            if ((rows[y / scale] >> (BUILTIN_WIDTH - 1 - x / scale)) & 1) {
+                coverage.values[static_cast<size_t>(y) * coverage.width + x] = 1.0f;
+            }
+        }
+    }
+}
+
+void GlyphAtlas::insert(char32_t c, const Coverage& coverage) {
+    GlyphSprite sprite;
+    sprite.advance = coverage.advance;
+    sprite.offset = core_plane.size();
+    if (coverage.width == 0 || coverage.height == 0) {
+        sprites[c] = sprite; // Spaces only move the pen
+        return;
+    }
+    sprite.width = coverage.width + 2 * margin;
+    sprite.height = coverage.height + 2 * margin;
+    sprite.left = coverage.left - margin;
+    sprite.top = coverage.top - margin;
+    size_t pixels = static_cast<size_t>(sprite.width) * sprite.height;
+    core_plane.resize(core_plane.size() + pixels, 0.0f);
+    glow_plane.resize(glow_plane.size() + pixels, 0.0f);
+    float* core = core_plane.data() + sprite.offset;
+    float* glow = glow_plane.data() + sprite.offset;
+    for (int y = 0; y < coverage.height; ++y) {
+        std::copy_n(coverage.values.data() + static_cast<size_t>(y) * coverage.width, coverage.width,
+                    core + static_cast<size_t>(y + margin) * sprite.width + margin);
+    }
+
+    // Separable Gaussian of the core, rows into a temporary, then columns into the glow
+    std::vector<float> rows(pixels, 0.0f);
+    for (int y = margin; y < margin + coverage.height; ++y) {
+        const float* in = core + static_cast<size_t>(y) * sprite.width;
+        float* out = rows.data() + static_cast<size_t>(y) * sprite.width;
+        for (int x = 0; x < sprite.width; ++x) {
+            float sum = 0.0f;
+            for (int k = std::max(0, x - margin); k <= std::min(sprite.width - 1, x + margin); ++k) {
+                sum += in[k] * kernel[k - x + margin];
+            }
+            out[x] = sum;
+        }
+    }
+    for (int y = 0; y < sprite.height; ++y) {
+        for (int x = 0; x < sprite.width; ++x) {
+            float sum = 0.0f;
+            for (int k = std::max(0, y - margin); k <= std::min(sprite.height - 1, y + margin); ++k) {
+                sum += rows[static_cast<size_t>(k) * sprite.width + x] * kernel[k - y + margin];
+            }
+            glow[static_cast<size_t>(y) * sprite.width + x] = sum;
+        }
+    }
+    sprites[c] = sprite;
+}
+
+std::u32string decode_utf8(const std::string& text) {
+    std::u32string result;
+    for (size_t i = 0; i < text.size(); ) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        int length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            result += U'\uFFFD';
+            i++;
+            continue;
+        }
+        char32_t c = length == 1 ? lead : lead & (0x7F >> length);
+        bool valid = true;
+        for (int k = 1; k < length; ++k) {
+            unsigned char next = static_cast<unsigned char>(text[i + k]);
+            valid = valid && (next >> 6) == 0x2;
+            c = (c << 6) | (next & 0x3F);
+        }
+        result += valid ? c : U'\uFFFD';
+        i += valid ? length : 1;
+    }
+    return result;
+}
@@ -2,10 +2,14 @@
 #include "save_bmp.h"
 
 #include "ImageGenerator.h"
+#include "Profiler.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 ImageGenerator::ImageGenerator()
     : width(100), height(100) {
+        falloff_cache = std::make_shared<FalloffCache>();
         conversion_factor = (width + height) / 2.0f/100.0f;
         max_radius = 7*conversion_factor;
         alpha.resize(width * height);
@@ -14,6 +18,7 @@ ImageGenerator::ImageGenerator()
 
 ImageGenerator::ImageGenerator(int width, int height)
     : width(width), height(height) {
+        falloff_cache = std::make_shared<FalloffCache>();
         conversion_factor = (width + height) / 2.0f/100.0f;
         max_radius = 7*conversion_factor;
         alpha.resize(width * height);
@@ -31,6 +36,8 @@ void ImageGenerator::drawPoints(const std::vector<Vector2f>& points, const std::
         float y = points[i].y();
         int ix = (int)x;
         int iy = (int)y;
+        dirty.add(std::max(0, ix - threshold_sigma), std::min(width - 1, ix + threshold_sigma),
+                  std::max(0, iy - threshold_sigma), std::min(height - 1, iy + threshold_sigma));
         for(int dx = ix-threshold_sigma; dx <= ix+threshold_sigma; ++dx) {
             if(dx < 0 || dx >= width) continue; // Skip out of bounds x
             for(int dy = iy-threshold_sigma; dy <= iy+threshold_sigma; ++dy) {
@@ -43,54 +50,245 @@ void ImageGenerator::drawPoints(const std::vector<Vector2f>& points, const std::
     }
 }
 
-std::vector<Vector2i> ImageGenerator::getMask(const LineSet& lineSet) const {
-    std::vector<Vector2i> mask = lineSet.getMask(max_line_distance);
+void ImageGenerator::clear() {
+    for (int y = dirty.y0; y < dirty.y1; ++y) {
+        std::fill(alpha.begin() + y * width + dirty.x0, alpha.begin() + y * width + dirty.x1, 0.0f);
+    }
+    dirty = Rect();
+}
+
+const SpanMask& ImageGenerator::getMask(const LineSet& lineSet) {
+    PROFILE_SCOPE(Stage::Mask);
+    span_mask.reset(width, height);
+    lineSet.getSpans(max_line_distance, span_mask);
 
-    return mask;
+    return span_mask;
+}
+
+float ImageGenerator::support_area(float path_length, int line_count, float point_glow_length) const {
+    float area = path_length * 2.0f * max_line_distance + line_count * static_cast<float>(M_PI) * max_line_distance * max_line_distance;
+    if (point_glow_length > 0.00001f) { // Same threshold as drawPoint
+        area += (2 * max_radius + 1) * (2 * max_radius + 1);
+    }
+    return area;
 }
 
 void ImageGenerator::drawLines(const LineSet& lineSet, const float& decay_length, const float& glow_length) {
-    std::vector<Vector2i> mask = getMask(lineSet);
-    
-    #pragma omp parallel for
-    for (size_t i = 0; i < mask.size(); ++i) {
-        Vector2f point((float)mask[i].x(), (float)mask[i].y());
-        // Add bounds check here
-        if (mask[i].x() >= 0 && mask[i].x() < width && mask[i].y() >= 0 && mask[i].y() < height) {
-            float t = lineSet.get_t(point);
-            float squaredDistance = lineSet.squaredDistance(point);
-            float new_alpha = exp(-sqrt(squaredDistance)/glow_length/(conversion_factor))*exp(-t/decay_length/conversion_factor*100.0f);
-            
-            alpha[mask[i].y() * width + mask[i].x()] = std::max(alpha[mask[i].y() * width + mask[i].x()], new_alpha);
+    PROFILE_SCOPE(Stage::DrawLines);
+    if (render_settings.engine == RenderEngine::Capsule) {
+        drawLinesCapsule(lineSet, decay_length, glow_length);
+    } else {
+        drawLinesMask(lineSet, decay_length, glow_length);
+    }
+}
+
+namespace {
+    // Interleaves the bits of x and y (Z-order), neighbouring tiles stay close in the traversal
+    uint32_t mortonCode(uint32_t x, uint32_t y) {
+        uint32_t code = 0;
+        for (int bit = 0; bit < 16; ++bit) {
+            code |= ((x >> bit) & 1u) << (2 * bit);
+            code |= ((y >> bit) & 1u) << (2 * bit + 1);
+        }
+        return code;
+    }
+}
+
+void ImageGenerator::collectTiles(int min_x, int max_x, int min_y, int max_y, int origin_x, int origin_y) {
+    // Tiles covering [min_x, max_x] x [min_y, max_y] on a lattice through (origin_x, origin_y)
+    const int size = render_settings.tile_size;
+    auto tile_index = [size](int p, int origin) {
+        int d = p - origin;
+        return d >= 0 ? d / size : -((size - 1 - d) / size);
+    };
+    int tx0 = tile_index(min_x, origin_x);
+    int tx1 = tile_index(max_x, origin_x);
+    int ty0 = tile_index(min_y, origin_y);
+    int ty1 = tile_index(max_y, origin_y);
+
+    tiles.clear();
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            tiles.push_back(Tile{origin_x + tx * size, origin_y + ty * size});
+        }
+    }
+    std::sort(tiles.begin(), tiles.end(), [&](const Tile& a, const Tile& b) {
+        return mortonCode((a.x - origin_x) / size - tx0, (a.y - origin_y) / size - ty0)
+             < mortonCode((b.x - origin_x) / size - tx0, (b.y - origin_y) / size - ty0);
+    });
+}
+
+void ImageGenerator::drawLinesMask(const LineSet& lineSet, const float& decay_length, const float& glow_length) {
+    const SpanMask& mask = getMask(lineSet);
+    if (mask.empty()) return;
+    dirty.add(mask.minX(), mask.maxX(), mask.firstRow(), mask.lastRow());
+    const int size = render_settings.tile_size;
+    segment_grid.build(lineSet, size, max_line_distance);
+    glow_kernel.setLines(lineSet);
+    glow_kernel.setGlow(glow_length, decay_length, conversion_factor, lineFalloff(glow_length));
+
+    // Tiles start on the grid origin and the cell size is the tile size times a power of two
+    // (the grid doubles it for large extents), so a tile never straddles two cells: it is
+    // one cell, or a fraction of one.
+    // Every pixel belongs to exactly one tile and is shaded once by the thread that owns it,
+    // which makes the result independent of the thread count.
+    collectTiles(mask.minX(), mask.maxX(), mask.firstRow(), mask.lastRow(), segment_grid.originX(), segment_grid.originY());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < tiles.size(); ++k) {
+        const Tile& tile = tiles[k];
+        int y0 = std::max(tile.y, mask.firstRow());
+        int y1 = std::min(tile.y + size - 1, mask.lastRow());
+        for (int y = y0; y <= y1; ++y) {
+            float* alpha_row = alpha.data() + y * width;
+            for (const Span& span : mask.row(y)) {
+                int x = std::max(span.x0, tile.x);
+                int x_end = std::min(span.x1, tile.x + size);
+                while (x < x_end) {
+                    const int* begin;
+                    const int* end;
+                    int next = segment_grid.run(x, x_end, y, begin, end);
+                    glow_kernel.shadeRun(begin, end, y, x, next, alpha_row);
+                    x = next;
+                }
+            }
+        }
+    }
+}
+
+void ImageGenerator::drawLinesCapsule(const LineSet& lineSet, const float& decay_length, const float& glow_length) {
+    // Each line only touches the pixels of its own capsule. The path parameter follows
+    // from the index of the line, the same way LineSet::get_t maps it for the nearest line.
+    const float radius = max_line_distance / 2.0f;
+    const float squared_radius = radius * radius;
+    const size_t n = lineSet.lines.size();
+    const FalloffTable& falloff = lineFalloff(glow_length);
+    const int size = render_settings.tile_size;
+    const int tiles_x = (width + size - 1) / size;
+    const int tiles_y = (height + size - 1) / size;
+
+    // Clipped pixel bounds of a capsule, false if it misses the screen
+    auto bounds = [&](const Line& line, int& min_x, int& max_x, int& min_y, int& max_y) {
+        if (!line.startPoint.allFinite() || !line.endPoint.allFinite()) return false;
+        min_x = std::max(0, (int)std::floor(std::min(line.startPoint.x(), line.endPoint.x()) - radius));
+        max_x = std::min(width - 1, (int)std::ceil(std::max(line.startPoint.x(), line.endPoint.x()) + radius));
+        min_y = std::max(0, (int)std::floor(std::min(line.startPoint.y(), line.endPoint.y()) - radius));
+        max_y = std::min(height - 1, (int)std::ceil(std::max(line.startPoint.y(), line.endPoint.y()) + radius));
+        return min_x <= max_x && min_y <= max_y;
+    };
+
+    // Bin the lines into the screen tiles they touch, in ascending line order
+    tile_start.assign(tiles_x * tiles_y + 1, 0);
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            for (size_t k = 1; k < tile_start.size(); ++k) tile_start[k] += tile_start[k - 1];
+            tile_lines.resize(tile_start.back());
+        }
+        for (size_t i = 0; i < n; ++i) {
+            int min_x = 0, max_x = -1, min_y = 0, max_y = -1;
+            if (!bounds(lineSet.lines[i], min_x, max_x, min_y, max_y)) continue;
+            if (pass == 0) dirty.add(min_x, max_x, min_y, max_y);
+            for (int ty = min_y / size; ty <= max_y / size; ++ty) {
+                for (int tx = min_x / size; tx <= max_x / size; ++tx) {
+                    if (pass == 0) {
+                        tile_start[ty * tiles_x + tx + 1]++;
+                    } else {
+                        tile_lines[tile_start[ty * tiles_x + tx]++] = i;
+                    }
+                }
+            }
+        }
+    }
+    // The fill pass moved every start to the next tile, shift them back
+    for (size_t k = tile_start.size() - 1; k > 0; --k) tile_start[k] = tile_start[k - 1];
+    tile_start[0] = 0;
+
+    tiles.clear();
+    for (int ty = 0; ty < tiles_y; ++ty) {
+        for (int tx = 0; tx < tiles_x; ++tx) {
+            if (tile_start[ty * tiles_x + tx] != tile_start[ty * tiles_x + tx + 1]) {
+                tiles.push_back(Tile{tx * size, ty * size});
+            }
+        }
+    }
+    std::sort(tiles.begin(), tiles.end(), [size](const Tile& a, const Tile& b) {
+        return mortonCode(a.x / size, a.y / size) < mortonCode(b.x / size, b.y / size);
+    });
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < tiles.size(); ++k) {
+        const Tile& tile = tiles[k];
+        int bin = (tile.y / size) * tiles_x + tile.x / size;
+        for (int b = tile_start[bin]; b < tile_start[bin + 1]; ++b) {
+            int i = tile_lines[b];
+            const Line& line = lineSet.lines[i];
+            int min_x = 0, max_x = -1, min_y = 0, max_y = -1;
+            bounds(line, min_x, max_x, min_y, max_y);
+            min_x = std::max(min_x, tile.x);
+            max_x = std::min(max_x, tile.x + size - 1);
+            min_y = std::max(min_y, tile.y);
+            max_y = std::min(max_y, tile.y + size - 1);
+            for (int y = min_y; y <= max_y; ++y) {
+                for (int x = min_x; x <= max_x; ++x) {
+                    Vector2f point((float)x, (float)y);
+                    float local_t = line.get_t(point);
+                    float squaredDistance = line.squaredDistance(point, local_t);
+                    if (!(squaredDistance <= squared_radius)) continue;
+
+                    float t = (i + std::min(1.0f, std::max(0.0f, local_t))) / (float)n;
+                    float new_alpha = falloff.at_distance(squaredDistance)*exp(-t/decay_length/conversion_factor*100.0f);
+                    alpha[y * width + x] = std::max(alpha[y * width + x], new_alpha);
+                }
+            }
         }
     }
 }
 
 void ImageGenerator::drawPoint(const Vector2f& point, const float& glow_length) {
+    PROFILE_SCOPE(Stage::DrawPoint);
     if(glow_length <= 0.00001f) return;
     int ix = (int)point.x();
     int iy = (int)point.y();
+    // Offsets are integer, so the falloff is a lookup by squared distance
+    int max_squared_distance = 2 * max_radius * max_radius;
+    if (!point_falloff || point_falloff->glow_length != glow_length || point_falloff->conversion_factor != conversion_factor
+        || point_falloff->extent != (float)max_squared_distance) {
+        point_falloff = falloff_cache->radial(glow_length, conversion_factor, max_squared_distance);
+    }
+    const std::vector<float>& falloff = point_falloff->values;
+    dirty.add(std::max(0, ix - max_radius), std::min(width - 1, ix + max_radius),
+              std::max(0, iy - max_radius), std::min(height - 1, iy + max_radius));
     for (int dx = ix - max_radius; dx <= ix + max_radius; ++dx) {
         if (dx < 0 || dx >= width) continue; // Skip out of bounds x
         for (int dy = iy - max_radius; dy <= iy + max_radius; ++dy) {
             if (dy < 0 || dy >= height) continue; // Skip out of bounds y
-            float squaredDistance = (dx - ix) * (dx - ix) + (dy - iy) * (dy - iy);
+            int squaredDistance = (dx - ix) * (dx - ix) + (dy - iy) * (dy - iy);
             float prev_mag = alpha[dy * width + dx];
-            float new_mag = exp(-sqrt(squaredDistance)/glow_length/(conversion_factor));
+            float new_mag = falloff[squaredDistance];
             if (new_mag < 1/255.0f) continue; // Skip very small contributions
-            if (prev_mag>new_mag) {
-                // If the previous magnitude is greater, skip this pixel
-                continue;
-            } else if (prev_mag < new_mag) {
+            if (prev_mag < new_mag) {
                 // If the new magnitude is greater, update the pixel color
-                alpha[dy * width + dx] = exp(-sqrt(squaredDistance)/glow_length/(conversion_factor));
+                alpha[dy * width + dx] = new_mag;
             }
-            // imageData[dy * width + dx] += color * exp(-sqrt(squaredDistance) / glow_length / (conversion_factor));
-            // imageData[dy * width + dx] = imageData[dy * width + dx] / 2.0f;
         }
     }
 }
 
+const FalloffTable& ImageGenerator::lineFalloff(float glow_length) {
+    float max_distance = 2.0f * max_line_distance;
+    if (!line_falloff || line_falloff->glow_length != glow_length || line_falloff->conversion_factor != conversion_factor
+        || line_falloff->extent != max_distance) {
+        line_falloff = falloff_cache->line(glow_length, conversion_factor, max_distance);
+    }
+    return *line_falloff;
+}
+
+void ImageGenerator::set_falloff_cache(const std::shared_ptr<FalloffCache>& cache) {
+    falloff_cache = cache;
+    point_falloff.reset();
+    line_falloff.reset();
+}
+
 float ImageGenerator::gauss(float x, float y, float sigma) {
     return std::exp(-(x * x + y * y) / (2 * sigma * sigma));
 }
@@ -130,6 +328,11 @@ void ImageGenerator::saveImage(const std::string& filename, const Vector3f& colo
 
 }
 
+void ImageGenerator::set_render_settings(const RenderSettings& settings) {
+    render_settings = settings;
+    glow_kernel.set_simd(settings.simd);
+}
+
 void ImageGenerator::set_debug_mode(bool mode) {
     debug_mode = mode;
     if (debug_mode) {
@@ -0,0 +1,268 @@
+#include "KeyframeParser.h"
+#include "KeyframeSet.h"
+#include "MappedFile.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+    struct ChannelName {
+        std::string_view name;
+        Channel channel;
+        bool negate; // py and ry point up in the files, the camera's y axis points down
+    };
+
+    const ChannelName CHANNEL_NAMES[] = {
+        {"t", Channel::T, false},
+        {"l", Channel::Length, false},
+        {"dl", Channel::DecayLength, false},
+        {"gl", Channel::GlowLength, false},
+        {"pgl", Channel::PointGlowLength, false},
+        {"px", Channel::PositionX, false},
+        {"py", Channel::PositionY, true},
+        {"pz", Channel::PositionZ, false},
+        {"rx", Channel::RotationX, false},
+        {"ry", Channel::RotationY, true},
+        {"rz", Channel::RotationZ, false},
+        {"ra", Channel::RotationAngle, false},
+        {"s", Channel::Scale, false},
+        {"cse", Channel::CamShiftErr, false},
+        {"ose", Channel::ObjShiftErr, false},
+        {"csh", Channel::CamShearErr, false},
+        {"r", Channel::R, false},
+        {"phi", Channel::Phi, false},
+    };
+
+    struct CurveName {
+        std::string_view name;
+        std::string_view abbreviation;
+        KeyframeCurve curve;
+    };
+
+    // First match wins: IE, OE and IOE belong to the expo curves, the elastic curves
+    // can only be named in full in this format
+    const CurveName CURVE_NAMES[] = {
+        {"Linear", "L", KeyframeCurve::Linear},
+        {"InSine", "IS", KeyframeCurve::InSine},
+        {"OutSine", "OS", KeyframeCurve::OutSine},
+        {"InOutSine", "IOS", KeyframeCurve::InOutSine},
+        {"EaseInCubic", "I3", KeyframeCurve::EaseInCubic},
+        {"EaseOutCubic", "O3", KeyframeCurve::EaseOutCubic},
+        {"EaseInOutCubic", "IO3", KeyframeCurve::EaseInOutCubic},
+        {"StepStart", "SS", KeyframeCurve::StepStart},
+        {"StepMiddle", "SM", KeyframeCurve::StepMiddle},
+        {"StepEnd", "SE", KeyframeCurve::StepEnd},
+        {"InExpo", "IE", KeyframeCurve::InExpo},
+        {"OutExpo", "OE", KeyframeCurve::OutExpo},
+        {"InOutExpo", "IOE", KeyframeCurve::InOutExpo},
+        {"InCirc", "IC", KeyframeCurve::InCirc},
+        {"OutCirc", "OC", KeyframeCurve::OutCirc},
+        {"InOutCirc", "IOC", KeyframeCurve::InOutCirc},
+        {"InOver", "IO", KeyframeCurve::InOver},
+        {"OutOver", "OO", KeyframeCurve::OutOver},
+        {"InOutOver", "IOO", KeyframeCurve::InOutOver},
+        {"InElastic", "IE", KeyframeCurve::InElastic},
+        {"OutElastic", "OE", KeyframeCurve::OutElastic},
+        {"InOutElastic", "IOE", KeyframeCurve::InOutElastic},
+    };
+
+    const std::string_view PI_TEXT = "3.141593"; // std::to_string(M_PI)
+
+    bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    // Splits the next whitespace separated token off rest, empty when there is none
+    std::string_view next_token(std::string_view& rest) {
+        size_t begin = 0;
+        while (begin < rest.size() && is_space(rest[begin])) ++begin;
+        size_t end = begin;
+        while (end < rest.size() && !is_space(rest[end])) ++end;
+        std::string_view token = rest.substr(begin, end - begin);
+        rest.remove_prefix(end);
+        return token;
+    }
+}
+
+bool KeyframeParser::parse_file(const std::string& path, KeyframeSet& set) {
+    MappedFile file;
+    if (!file.open(path)) {
+        // Empty files cannot be mapped but are valid
+        std::error_code error;
+        return std::filesystem::is_regular_file(path, error) && std::filesystem::file_size(path, error) == 0;
+    }
+    parse(std::string_view(static_cast<const char*>(file.data()), file.size()), path, set);
+    return true;
+}
+
+void KeyframeParser::parse(std::string_view text, const std::string& name, KeyframeSet& set) {
+    KeyframeParser parser(text, name);
+    parser.run(set);
+}
+
+float KeyframeParser::parse_value(std::string_view text, const std::string& name, int line, int column) {
+    KeyframeParser parser(text, name);
+    parser.line_text = text;
+    parser.line_number = line;
+    parser.column_offset = column - 1;
+    return parser.expression(text);
+}
+
+bool KeyframeParser::parse_curve(std::string_view text, KeyframeCurve& curve) {
+    for (const auto& entry : CURVE_NAMES) {
+        if (text == entry.name || text == entry.abbreviation) {
+            curve = entry.curve;
+            return true;
+        }
+    }
+    return false;
+}
+
+void KeyframeParser::run(KeyframeSet& set) {
+    std::vector<Keyframe>* block = nullptr;
+    bool negate = false;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        line_text = text.substr(pos, end - pos);
+        pos = end + 1;
+        line_number++;
+
+        // Inside a block every line up to the next empty one is a keyframe
+        if (block) {
+            if (line_text.empty()) {
+                block = nullptr;
+                continue;
+            }
+            Keyframe keyframe = this->keyframe(line_text);
+            if (negate) {
+                keyframe.end_val = -keyframe.end_val;
+                if (!std::isnan(keyframe.start_val)) {
+                    keyframe.start_val = -keyframe.start_val;
+                }
+            }
+            block->push_back(keyframe);
+            continue;
+        }
+
+        if (line_text.empty() || line_text[0] != 'K') continue; // Comments and stray lines
+
+        std::string_view rest = line_text;
+        next_token(rest); // "K"
+        std::string_view channel = next_token(rest);
+        for (const auto& entry : CHANNEL_NAMES) {
+            if (channel == entry.name) {
+                block = &set.channel(entry.channel);
+                negate = entry.negate;
+                break;
+            }
+        }
+        if (channel.empty()) {
+            report("Warning", line_text, "missing channel name, skipping its keyframes");
+        } else if (!block) {
+            report("Warning", channel, "unknown channel '" + std::string(channel) + "', skipping its keyframes");
+        }
+    }
+}
+
+Keyframe KeyframeParser::keyframe(std::string_view line) {
+    std::string_view tokens[5];
+    size_t count = 0;
+    std::string_view rest = line;
+    for (std::string_view token = next_token(rest); !token.empty(); token = next_token(rest)) {
+        if (count < 5) tokens[count] = token;
+        count++;
+    }
+
+    if (count < 4 || count > 5) {
+        report("Error", line, "expected 4 or 5 fields, found " + std::to_string(count) + ", keyframe set to 0. Maybe add a blank line.");
+        return Keyframe(0, 0, 0);
+    }
+
+    float start_time = expression(tokens[0]);
+    KeyframeCurve curve = KeyframeCurve::Linear;
+    // Four fields without a curve when the last one looks like a number
+    if (count == 5 || std::isdigit(static_cast<unsigned char>(tokens[3][0])) || tokens[3][0] == '-') {
+        float start_val = expression(tokens[1]);
+        float end_time = expression(tokens[2]);
+        float end_val = expression(tokens[3]);
+        if (count == 5 && !parse_curve(tokens[4], curve)) {
+            report("Warning", tokens[4], "unknown curve '" + std::string(tokens[4]) + "', using Linear");
+        }
+        return Keyframe(start_time, end_time, start_val, end_val, curve);
+    }
+
+    float end_time = expression(tokens[1]);
+    float end_val = expression(tokens[2]);
+    if (!parse_curve(tokens[3], curve)) {
+        report("Warning", tokens[3], "unknown curve '" + std::string(tokens[3]) + "', using Linear");
+    }
+    return Keyframe(start_time, end_time, end_val, curve);
+}
+
+float KeyframeParser::expression(std::string_view expr) {
+    const char OPERATORS[] = {'+', '-', '*', '/'};
+    for (char op : OPERATORS) {
+        size_t pos = expr.find(op);
+        if (pos == std::string_view::npos) continue;
+        std::string_view lhs_text = expr.substr(0, pos);
+        std::string_view rhs_text = expr.substr(pos + 1);
+        float lhs = (op == '-' && lhs_text.empty()) ? 0.0f : expression(lhs_text); // Negation
+        float rhs = expression(rhs_text);
+        switch (op) {
+            case '+': return lhs + rhs;
+            case '-': return lhs - rhs;
+            case '*': return lhs * rhs;
+            default: return lhs / rhs;
+        }
+    }
+    return number(expr);
+}
+
+// std::stof of the text with its first p replaced by PI_TEXT
+float KeyframeParser::number(std::string_view atom) {
+    if (atom.empty()) {
+        report("Error", atom, "missing number, using 0");
+        return 0.0f;
+    }
+    size_t p = atom.find('p');
+    if (p != std::string_view::npos && atom.find('p', p + 1) != std::string_view::npos) {
+        report("Warning", atom.substr(atom.find('p', p + 1)), "only the first p of a number is replaced by pi");
+    }
+
+    char buffer[64];
+    size_t length = atom.size() + (p == std::string_view::npos ? 0 : PI_TEXT.size() - 1);
+    if (length >= sizeof(buffer)) {
+        report("Error", atom, "number too long, using 0");
+        return 0.0f;
+    }
+    if (p == std::string_view::npos) {
+        std::memcpy(buffer, atom.data(), atom.size());
+    } else {
+        std::memcpy(buffer, atom.data(), p);
+        std::memcpy(buffer + p, PI_TEXT.data(), PI_TEXT.size());
+        std::memcpy(buffer + p + PI_TEXT.size(), atom.data() + p + 1, atom.size() - p - 1);
+    }
+    buffer[length] = '\0';
+
+    char* end = nullptr;
+    errno = 0;
+    float value = std::strtof(buffer, &end);
+    if (end == buffer) {
+        report("Error", atom, "invalid number '" + std::string(atom) + "', using 0");
+        return 0.0f;
+    }
+    if (errno == ERANGE) {
+        report("Warning", atom, "number '" + std::string(atom) + "' is out of range");
+    }
+    return value;
+}
+
+void KeyframeParser::report(const char* level, std::string_view at, const std::string& message) const {
+    int column = static_cast<int>(at.data() - line_text.data()) + 1 + column_offset;
+    std::cerr << name << ":" << line_number << ":" << column << ": " << level << ": " << message << std::endl;
+}
@@ -1,109 +1,11 @@
 #include "KeyframeSet.h"
-#include <fstream>
+#include "KeyframeParser.h"
+#include <algorithm>
 #include <iostream>
-#include <sstream>
+#include <limits>
 
-float KeyframeSet::apply_curve(float t, KeyframeCurve curve) const {
-    switch (curve) {
-        case KeyframeCurve::Linear:
-            return t;
-        case KeyframeCurve::InSine:
-            return 1 - std::cos((t * M_PI) / 2);
-        case KeyframeCurve::OutSine:
-            return std::sin((t * M_PI) / 2);
-        case KeyframeCurve::InOutSine:
-            return -0.5f * (std::cos(M_PI * t) - 1);
-        case KeyframeCurve::EaseInCubic:
-            return t * t * t;
-        case KeyframeCurve::EaseOutCubic:
-            return 1 - std::pow(1 - t, 3);
-        case KeyframeCurve::EaseInOutCubic:
-            if (t < 0.5f) {
-                return 4 * t * t * t;
-            } else {
-                float f = ((2 * t) - 2);
-                return 0.5f * f * f * f + 1;
-            }
-        case KeyframeCurve::StepStart:
-            return (t <= 0.0f) ? 0.0f : 1.0f;
-        case KeyframeCurve::StepMiddle:
-            return (t < 0.5f) ? 0.0f : 1.0f;
-        case KeyframeCurve::StepEnd:
-            return (t <= 1.0f) ? 0.0f : 1.0f;
-        case KeyframeCurve::InExpo:
-            return (t == 0.0f) ? 0.0f : std::pow(2, 10 * (t - 1));
-        case KeyframeCurve::OutExpo:
-            return (t == 1.0f) ? 1.0f : 1 - std::pow(2, -10 * t);
-        case KeyframeCurve::InOutExpo:
-            if (t == 0.0f) return 0.0f;
-            if (t == 1.0f) return 1.0f;
-            if (t < 0.5f) return std::pow(2, 20 * t - 10) / 2;
-            return (2 - std::pow(2, -20 * t + 10)) / 2;
-        case KeyframeCurve::InCirc:
-            return 1 - std::sqrt(1 - t * t);
-        case KeyframeCurve::OutCirc:
-            return std::sqrt((2 - 1)*t);
-        case KeyframeCurve::InOutCirc:
-            if (t < 0.5f) {
-                return (1 - std::sqrt(1 - 4 * (t * t))) / 2;
-            } else {
-                return (std::sqrt(-((2 * t) - 3) * ((2 * t) - 1)) + 1) / 2;
-            }
-        case KeyframeCurve::InOver:
-            {
-                float s1 = 1.70158f;
-                return t * t * ((s1 + 1) * t - s1);
-            }
-        case KeyframeCurve::OutOver:
-            {
-                float s2 = 1.70158f;
-                t = t - 1;
-                return t * t * ((s2 + 1) * t + s2) + 1;
-            }
-        case KeyframeCurve::InOutOver:
-            {
-                float s3 = 1.70158f * 1.525f;
-                if (t < 0.5f) {
-                    return (t * 2) * (t * 2) * ((s3 + 1) * (t * 2) - s3) / 2;
-                } else {
-                    t = t * 2 - 2;
-                    return (t * t * ((s3 + 1) * t + s3) + 2) / 2;
-                }
-            }
-        case KeyframeCurve::InElastic:
-            {
-                float c4 = 10.75f;
-                float c5 = (2 * M_PI) / 3;
-                if (t == 0) return 0;
-                if (t == 1) return 1;
-                return -std::pow(2, 10 * (t - 1)) * std::sin((t*10-c4) * c5);
-            }
-        case KeyframeCurve::OutElastic:
-            {
-                float c6 = 10.75f;
-                float c7 = (2 * M_PI) / 3;
-
-                if (t == 0) return 0;
-                if (t == 1) return 1;
-                return std::pow(2, -10 * t) * std::sin((t*10-c6) * c7) + 1;
-            }
-        case KeyframeCurve::InOutElastic:
-            {
-                float c8 = 11.125f;
-                float c9 = (2 * M_PI) / 4.5;
-
-                if (t == 0) return 0;
-                if (t == 1) return 1;
-                if (t < 0.5f) {
-                    return -(std::pow(2, 20 * t - 10) * std::sin((20 * t - c8) * c9)) / 2;
-                } else {
-                    return (std::pow(2, -20 * t + 10) * std::sin((20 * t - c8) * c9)) / 2 + 1;
-                }
-            }
-        default:
-            std::cerr << "Ease function not implemented yet" << std::endl;
-            return t; // Fallback to linear if unknown
-    }
+KeyframeSet::KeyframeSet() {
+    compile();
 }
 
 KeyframeSet::KeyframeSet(std::vector<KeyframeCollection> collections) {
@@ -149,298 +51,19 @@ KeyframeSet::KeyframeSet(std::vector<KeyframeCollection> collections) {
 
     check_for_overlaps();
     sort_keyframes();
+    compile();
 }
 
 KeyframeSet::KeyframeSet(const std::string& filename) {
-    // Load keyframes from a file
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    if (!KeyframeParser::parse_file(filename, *this)) {
         std::cerr << "Error: Could not open file " << filename << std::endl;
+        compile();
         return;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
-        // Skip lines starting with #
-        if (line[0] == '#') continue;
-
-        if (line.empty()) continue;
-
-        
-        if (line[0] == 'K'){
-            std::istringstream ss(line);
-            std::string token;
-            ss >> token; // Read "Keyframe"
-            ss >> token; // Read keyframe type
-            
-            if(token == "px"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    object_position_x.push_back(keyframe);
-                }
-            }
-            if(token == "py"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    keyframe.end_val = -keyframe.end_val;
-                    if(!std::isnan(keyframe.start_val)){
-                        keyframe.start_val = -keyframe.start_val;
-                    }
-                    object_position_y.push_back(keyframe);
-                }
-            }
-            if(token == "pz"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    object_position_z.push_back(keyframe);
-                }
-            }
-            if(token == "rx"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    object_rotation_x.push_back(keyframe);
-                }
-            }
-            if(token == "ry"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    keyframe.end_val = -keyframe.end_val;
-                    if(!std::isnan(keyframe.start_val)){
-                        keyframe.start_val = -keyframe.start_val;
-                    }
-                    object_rotation_y.push_back(keyframe);
-                }
-            }
-            if(token == "rz"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    object_rotation_z.push_back(keyframe);
-                }
-            }
-            if(token == "t"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    t.push_back(keyframe);
-                }
-            }
-            if(token == "l"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    length.push_back(keyframe);
-                }
-            }
-            if(token == "dl"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    decay_length.push_back(keyframe);
-                }
-            }
-            if(token == "gl"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    glow_length.push_back(keyframe);
-                }
-            }
-            if(token == "pgl"){
-                while (std::getline(file, line)) {
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    point_glow_length.push_back(keyframe);
-                }
-            }
-            
-            
-            if(token == "ra"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    object_rotation_angle.push_back(keyframe);
-                }
-            }
-            if(token == "s"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    object_scale.push_back(keyframe);
-                }
-            }
-            if(token == "cse"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    cam_shift_err.push_back(keyframe);
-                }
-            }
-            if(token == "ose"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    obj_shift_err.push_back(keyframe);
-                }
-            }
-            if(token == "csh"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    cam_shear_err.push_back(keyframe);
-                }
-            }
-            if(token == "r"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    r.push_back(keyframe);
-                }
-            }
-            if(token == "phi"){
-                while (std::getline(file, line)){
-                    if (line.empty()) break;
-                    Keyframe keyframe = parse_keyframe(line);
-                    phi.push_back(keyframe);
-                }
-            }
-        }
-
-    }
-
-    file.close();
-
     check_for_overlaps();
     sort_keyframes();
-}
-
-Keyframe KeyframeSet::parse_keyframe(const std::string& line) {
-    std::istringstream ss(line);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (ss >> token) {
-        tokens.push_back(token);
-    }
-
-    if (tokens.size() < 4) {
-        std::cerr << "Error: Invalid keyframe line: " << line << std::endl;
-        std::cerr << "Maybe add a blank line." << std::endl;
-        return Keyframe(0, 0, 0);
-    }
-
-    if(tokens.size() > 5){
-        std::cerr << "Warning: Extra tokens in keyframe line: " << line << std::endl;
-        std::cerr << "Maybe add a blank line." << std::endl;
-    }
-    float start_time = 0.0f;
-    float end_time = 0.0f;
-    float start_val = NAN; // Use previous keyframe's end_val
-    float end_val = 0.0f;
-    KeyframeCurve curve = KeyframeCurve::Linear; // Default to Linear
-
-    if (tokens.size() == 5) {
-        start_time = convert_string_to_float(tokens[0]);
-        start_val = convert_string_to_float(tokens[1]);
-        end_time = convert_string_to_float(tokens[2]);
-        end_val = convert_string_to_float(tokens[3]);
-        curve = string_to_curve(tokens[4]);
-        Keyframe kf = Keyframe(start_time, end_time, start_val, end_val, curve);
-        return kf;
-
-    } else if (tokens.size() == 4) {
-        if (std::isdigit(tokens[3][0]) || tokens[3][0] == '-') {
-            start_time = convert_string_to_float(tokens[0]);
-            start_val = convert_string_to_float(tokens[1]);
-            end_time = convert_string_to_float(tokens[2]);
-            end_val = convert_string_to_float(tokens[3]);
-        } else {
-            start_time = convert_string_to_float(tokens[0]);
-            end_time = convert_string_to_float(tokens[1]);
-            end_val = convert_string_to_float(tokens[2]);
-            curve = string_to_curve(tokens[3]);
-        }
-    }
-
-    return Keyframe(start_time, end_time, start_val, end_val, curve);
-}
-
-float KeyframeSet::convert_string_to_float(std::string str) {
-    // if there is "p" in the string replace it with the value of pi
-    size_t pos = str.find('p');
-    if (pos != std::string::npos) {
-        str.replace(pos, 1, std::to_string(M_PI));
-    }
-
-    // if there is a "+" in the string perform addition
-    pos = str.find('+');
-    if (pos != std::string::npos) {
-        float lhs = convert_string_to_float(str.substr(0, pos));
-        float rhs = convert_string_to_float(str.substr(pos + 1));
-        return lhs + rhs;
-    }
-    // if there is a "-" in the string perform subtraction
-    pos = str.find('-');
-    if (pos != std::string::npos) {
-        float lhs = convert_string_to_float(str.substr(0, pos));
-        float rhs = convert_string_to_float(str.substr(pos + 1));
-        return lhs - rhs;
-    }
-
-    // if there is a "*" in the string perform multiplication
-    pos = str.find('*');
-    if (pos != std::string::npos) {
-        float lhs = convert_string_to_float(str.substr(0, pos));
-        float rhs = convert_string_to_float(str.substr(pos + 1));
-        return lhs * rhs;
-    }
-
-    // if there is a "/" in the string perform division
-    pos = str.find('/');
-    if (pos != std::string::npos) {
-        float lhs = convert_string_to_float(str.substr(0, pos));
-        float rhs = convert_string_to_float(str.substr(pos + 1));
-        return lhs / rhs;
-    }
-
-    try {
-        return std::stof(str);
-    } catch (const std::invalid_argument& e) {
-        std::cerr << "Error: Invalid float value '" << str << "'" << std::endl;
-        return 0.0f; // Default value on error
-    }
-}
-
-KeyframeCurve KeyframeSet::string_to_curve(const std::string& curve_str) {
-    if (curve_str == "Linear" || curve_str == "L") return KeyframeCurve::Linear;
-    if (curve_str == "InSine" || curve_str == "IS") return KeyframeCurve::InSine;
-    if (curve_str == "OutSine" || curve_str == "OS") return KeyframeCurve::OutSine;
-    if (curve_str == "InOutSine" || curve_str == "IOS") return KeyframeCurve::InOutSine;
-    if (curve_str == "EaseInCubic" || curve_str == "I3") return KeyframeCurve::EaseInCubic;
-    if (curve_str == "EaseOutCubic" || curve_str == "O3") return KeyframeCurve::EaseOutCubic;
-    if (curve_str == "EaseInOutCubic" || curve_str == "IO3") return KeyframeCurve::EaseInOutCubic;
-    if (curve_str == "StepStart" || curve_str == "SS") return KeyframeCurve::StepStart;
-    if (curve_str == "StepMiddle" || curve_str == "SM") return KeyframeCurve::StepMiddle;
-    if (curve_str == "StepEnd" || curve_str == "SE") return KeyframeCurve::StepEnd;
-    if (curve_str == "InExpo" || curve_str == "IE") return KeyframeCurve::InExpo;
-    if (curve_str == "OutExpo" || curve_str == "OE") return KeyframeCurve::OutExpo;
-    if (curve_str == "InOutExpo" || curve_str == "IOE") return KeyframeCurve::InOutExpo;
-    if (curve_str == "InCirc" || curve_str == "IC") return KeyframeCurve::InCirc;
-    if (curve_str == "OutCirc" || curve_str == "OC") return KeyframeCurve::OutCirc;
-    if (curve_str == "InOutCirc" || curve_str == "IOC") return KeyframeCurve::InOutCirc;
-    if (curve_str == "InOver" || curve_str == "IO") return KeyframeCurve::InOver;
-    if (curve_str == "OutOver" || curve_str == "OO") return KeyframeCurve::OutOver;
-    if (curve_str == "InOutOver" || curve_str == "IOO") return KeyframeCurve::InOutOver;
-    if (curve_str == "InElastic" || curve_str == "IE") return KeyframeCurve::InElastic;
-    if (curve_str == "OutElastic" || curve_str == "OE") return KeyframeCurve::OutElastic;
-    if (curve_str == "InOutElastic" || curve_str == "IOE") return KeyframeCurve::InOutElastic;
-
-    std::cerr << "Warning: Unknown curve type '" << curve_str << "', defaulting to Linear." << std::endl;
-    return KeyframeCurve::Linear; // Default to Linear
+    compile();
 }
 
 void KeyframeSet::check_for_overlaps() {
@@ -486,51 +109,116 @@ void KeyframeSet::sort_keyframes() {
 }
 
 float KeyframeSet::get_value(std::vector<Keyframe>& keyframes, float time, float default_val) {
-    if (keyframes.empty()) return default_val;
+    return CompiledTrack::evaluate(CompiledTrack::classify(keyframes, time, default_val), keyframes, time);
+}
+
+namespace {
+    // Bitwise equal apart from the NaN payload, -0 and 0 can give different results
+    bool same_value(float a, float b) {
+        return (std::isnan(a) && std::isnan(b)) || (a == b && std::signbit(a) == std::signbit(b));
+    }
 
-    for (size_t i = 0; i < keyframes.size(); ++i) {
-        const auto& kf = keyframes[i];
-        if (kf.start_time <= time && kf.end_time >= time) {
-            if (kf.start_time == kf.end_time) {
-                return kf.end_val; // Avoid division by zero
+    bool same_keyframe(const Keyframe& a, const Keyframe& b) {
+        return same_value(a.start_time, b.start_time) && same_value(a.end_time, b.end_time)
+            && same_value(a.start_val, b.start_val) && same_value(a.end_val, b.end_val) && a.curve == b.curve;
+    }
+
+    // Times at which the keyframes of keyframes that other does not have can decide the
+    // value: their span, the hold after them up to the next keyframe, and that next
+    // keyframe too when it starts from the inherited end value
+    void add_changed(const std::vector<Keyframe>& keyframes, const std::vector<Keyframe>& other, std::vector<std::pair<float, float>>& intervals) {
+        const float inf = std::numeric_limits<float>::infinity();
+        for (size_t i = 0; i < keyframes.size(); ++i) {
+            const Keyframe& kf = keyframes[i];
+            if (std::any_of(other.begin(), other.end(), [&](const Keyframe& o) { return same_keyframe(kf, o); })) {
+                continue;
             }
-            // If we found a keyframe that contains the time, return its value
-            float start_val = kf.start_val;
-            if(std::isnan(start_val)) {
-                if(i == 0) {
-                    start_val = kf.end_val; // If it's the first keyframe, use its end_val
-                } else {
-                    // Find the previous keyframe's end_val
-                    start_val = keyframes[i - 1].end_val;
-                }
+            float first = kf.start_time;
+            float last = kf.end_time;
+            if (i + 1 == keyframes.size()) {
+                last = inf; // The last end value holds until the end
+            } else {
+                const Keyframe& next = keyframes[i + 1];
+                last = std::max(last, std::isnan(next.start_val) ? next.end_time : next.start_time);
+            }
+            if (std::isnan(first) || std::isnan(last)) {
+                first = -inf;
+                last = inf;
             }
-            // std::cout << "Im right here!" << std::endl;
-            // std::cout << start_val <<" " << kf.end_val << " " << (kf.end_val - start_val) << std::endl;
-            return start_val + apply_curve((time - kf.start_time) / (kf.end_time - kf.start_time), kf.curve) * (kf.end_val - start_val);
+            intervals.push_back({std::min(first, last), last});
         }
     }
+}
 
-    //Check if the time is between two keyframes.
-    //If so take the end_value of the perv keyframe
-    for (size_t i = 0; i < keyframes.size() - 1; ++i) {
-        if (keyframes[i].end_time < time && time < keyframes[i + 1].start_time) {
-            return keyframes[i].end_val;
-        }
+std::vector<std::pair<float, float>> KeyframeSet::changed_intervals(const std::vector<Keyframe>& previous, const std::vector<Keyframe>& current) {
+    std::vector<std::pair<float, float>> intervals;
+    add_changed(previous, current, intervals);
+    add_changed(current, previous, intervals);
+
+    // Before the first keyframe the value is its end value when the start value is inherited
+    bool same_front = !previous.empty() && !current.empty() && same_keyframe(previous.front(), current.front());
+    bool front_inherits = (!previous.empty() && std::isnan(previous.front().start_val))
+        || (!current.empty() && std::isnan(current.front().start_val));
+    if (!same_front && front_inherits) {
+        float front = -std::numeric_limits<float>::infinity();
+        if (!previous.empty()) front = std::max(front, previous.front().start_time);
+        if (!current.empty()) front = std::max(front, current.front().start_time);
+        intervals.push_back({-std::numeric_limits<float>::infinity(), front});
     }
 
-    //Check if the time is before the first keyframe
-    if (time < keyframes.front().start_time) {
-        if(std::isnan(keyframes.front().start_val)){
-            return keyframes.front().end_val;
+    std::sort(intervals.begin(), intervals.end());
+    std::vector<std::pair<float, float>> merged;
+    for (const auto& interval : intervals) {
+        if (!merged.empty() && interval.first <= merged.back().second) {
+            merged.back().second = std::max(merged.back().second, interval.second);
+        } else {
+            merged.push_back(interval);
         }
     }
+    return merged;
+}
 
-    //Check if the time is after the last keyframe
-    if (time > keyframes.back().end_time) {
-        return keyframes.back().end_val;
+const std::vector<Keyframe>& KeyframeSet::channel(Channel channel) const {
+    return const_cast<KeyframeSet*>(this)->channel(channel);
+}
+
+std::vector<Keyframe>& KeyframeSet::channel(Channel channel) {
+    switch (channel) {
+        case Channel::T: return t;
+        case Channel::Length: return length;
+        case Channel::DecayLength: return decay_length;
+        case Channel::GlowLength: return glow_length;
+        case Channel::PointGlowLength: return point_glow_length;
+        case Channel::PositionX: return object_position_x;
+        case Channel::PositionY: return object_position_y;
+        case Channel::PositionZ: return object_position_z;
+        case Channel::RotationX: return object_rotation_x;
+        case Channel::RotationY: return object_rotation_y;
+        case Channel::RotationZ: return object_rotation_z;
+        case Channel::RotationAngle: return object_rotation_angle;
+        case Channel::Scale: return object_scale;
+        case Channel::CamShiftErr: return cam_shift_err;
+        case Channel::ObjShiftErr: return obj_shift_err;
+        case Channel::CamShearErr: return cam_shear_err;
+        case Channel::R: return r;
+        case Channel::Phi: return phi;
+        default: return t;
+    }
+}
+
+float KeyframeSet::default_value(Channel channel) {
+    switch (channel) {
+        case Channel::GlowLength: return 0.5f;
+        case Channel::PointGlowLength: return 1.0f;
+        default: return 0.0f;
     }
+}
 
-    return default_val;
+void KeyframeSet::compile() {
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        Channel ch = static_cast<Channel>(c);
+        tracks[c] = CompiledTrack::compile(channel(ch), default_value(ch));
+    }
 }
 
 float KeyframeSet::get_start_time() const {
@@ -13,42 +13,40 @@ void LineSet::addLine(const Line& line) {
 }
 
 float LineSet::get_t(const Vector2f& point) const {
-    float min_t = std::numeric_limits<float>::max();
-    float min_dist = std::numeric_limits<float>::max();
-    int closest_line_index = -1;
+    return get_t(nearest(point));
+}
+
+float LineSet::get_t(const SegmentHit& hit) const {
+    // Convert the local parameter of the closest line into the parameter along the whole path
+    if(hit.t < 0){
+        return hit.index/(float)lines.size();
+    }else if(hit.t > 1){
+        return (hit.index + 1)/(float)lines.size();
+    }else{
+        return (hit.index + hit.t)/(float)lines.size();
+    }
+}
+
+SegmentHit LineSet::nearest(const Vector2f& point) const {
+    SegmentHit hit;
     for (size_t i = 0; i < lines.size(); ++i) {
         float t = lines[i].get_t(point);
         float dist = lines[i].squaredDistance(point, t);
-        if (dist < min_dist) {
-            min_dist = dist;
-            closest_line_index = i;
-            min_t = t;
+        if (dist < hit.squared_distance) {
+            hit.squared_distance = dist;
+            hit.index = i;
+            hit.t = t;
         }
     }
-    if(min_t < 0){
-        return closest_line_index/(float)lines.size();
-    }else if(min_t > 1){
-        return (closest_line_index + 1)/(float)lines.size();
-    }else{
-        return (closest_line_index + min_t)/(float)lines.size();
-    }
+    return hit;
 }
 
 float LineSet::squaredDistance(const Vector2f& point) const {
-    float min_dist = std::numeric_limits<float>::max();
-    for (const Line& line : lines) {
-        float t = line.get_t(point);
-        float dist = line.squaredDistance(point, t);
-        if (dist < min_dist) {
-            min_dist = dist;
-        }
-    }
-    return min_dist;
+    return nearest(point).squared_distance;
 }
 
-std::vector<Vector2i> LineSet::getMask(float size) const {
-    std::vector<Vector2i> mask;
-    if (lines.empty()) return mask; // Prevent crash if no lines
+void LineSet::getSpans(float size, SpanMask& mask) const {
+    if (lines.empty()) return; // Prevent crash if no lines
 
     // First create the outline mask as before
     Vector2f v1, v2, v3, v4;
@@ -80,22 +78,18 @@ std::vector<Vector2i> LineSet::getMask(float size) const {
         int min_y = std::floor(std::min({v1.y(), v2.y(), v3.y(), v4.y()}));
         int max_y = std::ceil(std::max({v1.y(), v2.y(), v3.y(), v4.y()}));
         
-        // Limit rectangle size to prevent excessive memory usage
+        // Limit rectangle size to prevent runaway rectangles
         const int MAX_SIZE = 1000;
         if (max_x - min_x > MAX_SIZE) max_x = min_x + MAX_SIZE;
         if (max_y - min_y > MAX_SIZE) max_y = min_y + MAX_SIZE;
         
-        for (int x = min_x; x <= max_x; ++x) {
-            for (int y = min_y; y <= max_y; ++y) {
-                mask.push_back(Vector2i(x, y));
-            }
-        }
+        mask.addRect(min_x, max_x, min_y, max_y);
         
         v1 = v3;
         v2 = v4;
     }
-    
-    return mask;
+
+    mask.merge();
 }
 
 Vector2f LineSet::getStartPoint() const
@@ -0,0 +1,167 @@
+#include "LineSocket.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+    bool is_tcp(const std::string& address) {
+        return address.rfind("tcp:", 0) == 0;
+    }
+
+    std::string unix_path(const std::string& address) {
+        return address.rfind("unix:", 0) == 0 ? address.substr(5) : address;
+    }
+
+    bool tcp_address(const std::string& address, sockaddr_in& addr) {
+        int port = std::atoi(address.c_str() + 4);
+        if (port <= 0 || port > 65535) {
+            std::cerr << "Invalid port in " << address << std::endl;
+            return false;
+        }
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local processes only
+        return true;
+    }
+
+    bool unix_address(const std::string& address, sockaddr_un& addr) {
+        std::string path = unix_path(address);
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Invalid socket path " << path << std::endl;
+            return false;
+        }
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+}
+
+LineSocket::~LineSocket() {
+    close();
+}
+
+LineSocket::LineSocket(LineSocket&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), buffer(std::move(other.buffer)) {
+}
+
+LineSocket& LineSocket::operator=(LineSocket&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+        buffer = std::move(other.buffer);
+    }
+    return *this;
+}
+
+bool LineSocket::connect(const std::string& address) {
+    close();
+    if (is_tcp(address)) {
+        sockaddr_in addr;
+        if (!tcp_address(address, addr)) return false;
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ >= 0 && ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return true;
+    } else {
+        sockaddr_un addr;
+        if (!unix_address(address, addr)) return false;
+        fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ >= 0 && ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return true;
+    }
+    close();
+    return false;
+}
+
+void LineSocket::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    buffer.clear();
+}
+
+bool LineSocket::send_line(const std::string& line) {
+    if (fd_ < 0) return false;
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        // No SIGPIPE when the peer died, the caller sees false instead
+        ssize_t count = send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0) return false;
+        sent += count;
+    }
+    return true;
+}
+
+bool LineSocket::receive() {
+    if (fd_ < 0) return false;
+    char chunk[4096];
+    ssize_t count = recv(fd_, chunk, sizeof(chunk), 0);
+    if (count <= 0) return false;
+    buffer.append(chunk, count);
+    return true;
+}
+
+bool LineSocket::next_line(std::string& line) {
+    size_t end = buffer.find('\n');
+    if (end == std::string::npos) return false;
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return true;
+}
+
+bool LineSocket::read_line(std::string& line) {
+    while (!next_line(line)) {
+        if (!receive()) return false;
+    }
+    return true;
+}
+
+int LineSocket::listen(const std::string& address) {
+    int fd = -1;
+    if (is_tcp(address)) {
+        sockaddr_in addr;
+        if (!tcp_address(address, addr)) return -1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (fd >= 0 && bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    } else {
+        sockaddr_un addr;
+        if (!unix_address(address, addr)) return -1;
+        unlink(addr.sun_path); // Left behind by a coordinator that did not exit cleanly
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0 || ::listen(fd, 64) != 0) {
+        std::cerr << "Cannot listen on " << address << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+LineSocket LineSocket::accept(int listen_fd) {
+    return LineSocket(::accept(listen_fd, nullptr, nullptr));
+}
+
+void LineSocket::close_listener(int listen_fd, const std::string& address) {
+    if (listen_fd < 0) return;
+    ::close(listen_fd);
+    if (!is_tcp(address)) {
+        unlink(unix_path(address).c_str());
+    }
+}
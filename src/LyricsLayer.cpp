@@ -0,0 +1,244 @@
+#include "LyricsLayer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // Layout of the captions of subtitle_generator/subtitle_gen.py, relative to 1080 rows
+    const float REFERENCE_HEIGHT = 1080.0f;
+    const float REFERENCE_SIZE = 52.0f;
+    const float REFERENCE_GLOW = 6.0f;
+    const float REFERENCE_BASELINE = 1040.0f;
+    const float GLOW_GAIN = 3.0f; // Brightness of the blurred text
+    const float MAX_LINE_WIDTH = 0.9f; // Share of the frame width before a caption wraps
+
+    std::string trim(const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) return "";
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+}
+
+LyricsLayer::LyricsLayer(const std::string& path, const LyricsStyle& style, int width, int height)
+    : style(style), width(width), height(height) {
+    float rows = height / REFERENCE_HEIGHT;
+    if (this->style.size <= 0) {
+        this->style.size = std::max(1, static_cast<int>(std::lround(REFERENCE_SIZE * rows)));
+    }
+    if (this->style.glow_radius < 0.0f) {
+        this->style.glow_radius = REFERENCE_GLOW * rows;
+    }
+    glow_color = (this->style.color * GLOW_GAIN).cwiseMin(1.0f);
+    if (!load(path)) {
+        return;
+    }
+
+    atlas = GlyphAtlas(this->style.font_path, this->style.size, this->style.glow_radius);
+    for (const auto& caption : captions) {
+        atlas.add(caption.text);
+    }
+    if (atlas.uses_freetype()) {
+        // Frames are cached across runs, a different file at the same path must not match
+        std::ifstream file(this->style.font_path, std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        Fnv1a hash;
+        hash.add(contents.str());
+        font_checksum = hash.get();
+    }
+    std::cout << "Loaded " << captions.size() << " captions from " << path << std::endl;
+}
+
+bool LyricsLayer::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open lyrics file " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        float time = 0.0f;
+        std::string text;
+        if (line[0] == '[') {
+            // LRC time tag, other tags such as [ar:...] are skipped
+            int minutes = 0;
+            float seconds = 0.0f;
+            size_t close = line.find(']');
+            if (close == std::string::npos || std::sscanf(line.c_str(), "[%d:%f]", &minutes, &seconds) != 2) continue;
+            time = minutes * 60.0f + seconds;
+            text = line.substr(close + 1);
+        } else {
+            char* end = nullptr;
+            time = std::strtof(line.c_str(), &end);
+            if (end == line.c_str()) {
+                std::cerr << path << ":" << line_number << ": expected a time in seconds, skipping the line" << std::endl;
+                continue;
+            }
+            text = line.substr(end - line.c_str());
+        }
+        captions.push_back({time, decode_utf8(trim(text))});
+    }
+    std::stable_sort(captions.begin(), captions.end(),
+        [](const Caption& a, const Caption& b) { return a.time < b.time; });
+    return true;
+}
+
+int LyricsLayer::caption_at(float time) const {
+    auto it = std::upper_bound(captions.begin(), captions.end(), time,
+        [](float t, const Caption& caption) { return t < caption.time; });
+    if (it == captions.begin()) return -1;
+    int index = static_cast<int>(it - captions.begin()) - 1;
+    return captions[index].text.empty() ? -1 : index;
+}
+
+int LyricsLayer::text_width(const std::u32string& text) const {
+    int total = 0;
+    for (char32_t c : text) {
+        if (const GlyphSprite* sprite = atlas.find(c)) total += sprite->advance;
+    }
+    return total;
+}
+
+// Greedy at spaces, a word wider than the line gets a line of its own
+std::vector<std::u32string> LyricsLayer::wrap(const std::u32string& text) const {
+    std::vector<std::u32string> lines;
+    int max_width = static_cast<int>(width * MAX_LINE_WIDTH);
+    std::u32string line;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = std::min(text.find(U' ', begin), text.size());
+        std::u32string word = text.substr(begin, end - begin);
+        std::u32string candidate = line.empty() ? word : line + U' ' + word;
+        if (!line.empty() && text_width(candidate) > max_width) {
+            lines.push_back(line);
+            line = word;
+        } else {
+            line = candidate;
+        }
+        begin = end + 1;
+    }
+    if (!line.empty()) lines.push_back(line);
+    return lines;
+}
+
+void LyricsLayer::build(int index, CaptionImage& image) const {
+    struct Placement {
+        const GlyphSprite* sprite;
+        int x;
+        int y;
+    };
+    std::vector<std::u32string> lines = wrap(captions[index].text);
+    int baseline = static_cast<int>(std::lround(REFERENCE_BASELINE / REFERENCE_HEIGHT * height));
+
+    // The last line sits on the baseline, the others above it
+    std::vector<Placement> placements;
+    Rect rect;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        int y = baseline - static_cast<int>(lines.size() - 1 - i) * atlas.line_height();
+        int x = (width - text_width(lines[i])) / 2;
+        for (char32_t c : lines[i]) {
+            const GlyphSprite* sprite = atlas.find(c);
+            if (!sprite) continue;
+            if (sprite->width > 0) {
+                placements.push_back({sprite, x + sprite->left, y + sprite->top});
+                rect.add(x + sprite->left, x + sprite->left + sprite->width - 1, y + sprite->top, y + sprite->top + sprite->height - 1);
+            }
+            x += sprite->advance;
+        }
+    }
+    rect.x0 = std::max(rect.x0, 0);
+    rect.y0 = std::max(rect.y0, 0);
+    rect.x1 = std::min(rect.x1, width);
+    rect.y1 = std::min(rect.y1, height);
+
+    image.index = index;
+    image.rect = rect;
+    image.core.clear();
+    image.glow.clear();
+    if (rect.empty()) return;
+    int rect_width = rect.x1 - rect.x0;
+    size_t pixels = static_cast<size_t>(rect_width) * (rect.y1 - rect.y0);
+    image.core.assign(pixels, 0.0f);
+    image.glow.assign(pixels, 0.0f);
+
+    // The blur is linear, so the glow of the caption is the sum of the glyph glows
+    for (const Placement& placement : placements) {
+        const GlyphSprite& sprite = *placement.sprite;
+        const float* core = atlas.core(sprite);
+        const float* glow = atlas.glow(sprite);
+        int y0 = std::max(placement.y, rect.y0), y1 = std::min(placement.y + sprite.height, rect.y1);
+        int x0 = std::max(placement.x, rect.x0), x1 = std::min(placement.x + sprite.width, rect.x1);
+        for (int y = y0; y < y1; ++y) {
+            size_t in_row = static_cast<size_t>(y - placement.y) * sprite.width;
+            size_t out_row = static_cast<size_t>(y - rect.y0) * rect_width;
+            for (int x = x0; x < x1; ++x) {
+                size_t in = in_row + (x - placement.x);
+                size_t out = out_row + (x - rect.x0);
+                image.core[out] = std::max(image.core[out], core[in]);
+                image.glow[out] += glow[in];
+            }
+        }
+    }
+    for (float& alpha : image.glow) {
+        alpha = std::min(1.0f, alpha * GLOW_GAIN);
+    }
+}
+
+void LyricsLayer::draw(float time, CaptionImage& image, uint8_t* rgb) const {
+    int index = caption_at(time);
+    if (index < 0) return;
+    PROFILE_SCOPE(Stage::Lyrics);
+    if (image.index != index) {
+        build(index, image);
+    }
+
+    // The glow over the frame, then the text over the glow
+    const Vector3f glow_rgb = glow_color * 255.0f;
+    const Vector3f core_rgb = style.color.cwiseMin(1.0f) * 255.0f;
+    int rect_width = image.rect.x1 - image.rect.x0;
+    for (int y = image.rect.y0; y < image.rect.y1; ++y) {
+        const float* core = image.core.data() + static_cast<size_t>(y - image.rect.y0) * rect_width;
+        const float* glow = image.glow.data() + static_cast<size_t>(y - image.rect.y0) * rect_width;
+        uint8_t* out = rgb + (static_cast<size_t>(y) * width + image.rect.x0) * 3;
+        for (int x = 0; x < rect_width; ++x) {
+            float a_glow = glow[x];
+            float a_core = core[x];
+            if (a_glow <= 0.0f && a_core <= 0.0f) continue;
+            for (int channel = 0; channel < 3; ++channel) {
+                float value = out[x * 3 + channel];
+                value += (glow_rgb[channel] - value) * a_glow;
+                value += (core_rgb[channel] - value) * a_core;
+                out[x * 3 + channel] = static_cast<uint8_t>(std::min(255.0f, value + 0.5f));
+            }
+        }
+    }
+}
+
+void LyricsLayer::add_to_hash(Fnv1a& hash, float time) const {
+    int index = caption_at(time);
+    if (index < 0) return; // Same pixels as without lyrics
+    const std::u32string& text = captions[index].text;
+    hash.add(static_cast<uint64_t>(text.size()));
+    hash.add(text.data(), text.size() * sizeof(char32_t));
+    // The font that was actually rasterized, the built-in one when loading the file failed
+    hash.add(static_cast<int32_t>(atlas.uses_freetype()));
+    if (atlas.uses_freetype()) {
+        hash.add(font_checksum);
+    }
+    hash.add(static_cast<int32_t>(style.size));
+    hash.add(style.color.x());
+    hash.add(style.color.y());
+    hash.add(style.color.z());
+    hash.add(style.glow_radius);
+}
@@ -0,0 +1,168 @@
+#include "Profiler.h"
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    const char* const STAGE_NAMES[STAGE_COUNT] = {
+        "frame", "keyframes", "project", "mask", "draw_lines", "draw_point", "composite", "lyrics", "convert", "save_bmp", "write"
+    };
+
+    struct Event {
+        uint64_t start_ns;
+        uint64_t end_ns;
+        int32_t frame;
+        Stage stage;
+    };
+
+    // 1.5 MB per thread, about 2000 frames of a five animator scene
+    const size_t RING_SIZE = size_t(1) << 16;
+
+    // Written only by its thread. count is published with release so a reader sees
+    // complete events. When the ring is full the oldest events are overwritten.
+    struct ThreadBuffer {
+        std::vector<Event> events = std::vector<Event>(RING_SIZE);
+        std::atomic<uint64_t> count{0};
+        int frame = -1;
+        int id = 0;
+        std::string name;
+    };
+
+    // Buffers outlive their threads, the frame writer is gone when the trace is written
+    std::mutex registry_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> registry;
+    uint64_t epoch_ns = 0;
+
+    ThreadBuffer& thread_buffer() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            auto created = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            created->id = static_cast<int>(registry.size()) + 1;
+            registry.push_back(created);
+            buffer = created.get();
+        }
+        return *buffer;
+    }
+
+    // Copies the recorded events of every thread, oldest first
+    std::vector<std::pair<const ThreadBuffer*, std::vector<Event>>> collect() {
+        std::vector<std::pair<const ThreadBuffer*, std::vector<Event>>> threads;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto& buffer : registry) {
+            uint64_t count = buffer->count.load(std::memory_order_acquire);
+            uint64_t first = count > RING_SIZE ? count - RING_SIZE : 0;
+            if (first > 0) {
+                std::cerr << "Profiler: thread " << buffer->id << " dropped its first " << first << " events" << std::endl;
+            }
+            std::vector<Event> events;
+            events.reserve(count - first);
+            for (uint64_t i = first; i < count; ++i) {
+                events.push_back(buffer->events[i & (RING_SIZE - 1)]);
+            }
+            threads.emplace_back(buffer.get(), std::move(events));
+        }
+        return threads;
+    }
+}
+
+std::atomic<bool> Profiler::active{false};
+
+void Profiler::enable() {
+    if (!compiled_in) {
+        return;
+    }
+    epoch_ns = now_ns();
+    active.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::set_frame(int frame) {
+    if (enabled()) {
+        thread_buffer().frame = frame;
+    }
+}
+
+void Profiler::set_thread_name(const char* name) {
+    if (enabled()) {
+        thread_buffer().name = name;
+    }
+}
+
+uint64_t Profiler::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(Stage stage, uint64_t start_ns, uint64_t end_ns) {
+    ThreadBuffer& buffer = thread_buffer();
+    uint64_t index = buffer.count.load(std::memory_order_relaxed);
+    buffer.events[index & (RING_SIZE - 1)] = Event{start_ns, end_ns, buffer.frame, stage};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::write_trace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Could not write the trace " << path << std::endl;
+        return false;
+    }
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << std::fixed << std::setprecision(3);
+    bool first = true;
+    auto separator = [&]() -> const char* {
+        const char* text = first ? "" : ",\n";
+        first = false;
+        return text;
+    };
+    for (const auto& [buffer, events] : collect()) {
+        std::string name = buffer->name.empty() ? "thread " + std::to_string(buffer->id) : buffer->name;
+        file << separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->id
+             << ", \"args\": {\"name\": \"" << name << "\"}}";
+        for (const auto& event : events) {
+            // Microseconds since enable()
+            file << separator() << "{\"name\": \"" << STAGE_NAMES[static_cast<int>(event.stage)]
+                 << "\", \"cat\": \"render\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id
+                 << ", \"ts\": " << (event.start_ns - epoch_ns) / 1e3 << ", \"dur\": " << (event.end_ns - event.start_ns) / 1e3
+                 << ", \"args\": {\"frame\": " << event.frame << "}}";
+        }
+    }
+    file << "\n]}\n";
+    std::cout << "Trace written to " << path << std::endl;
+    return true;
+}
+
+bool Profiler::write_frame_csv(const std::string& path) {
+    std::map<int, std::array<double, STAGE_COUNT>> frames;
+    for (const auto& [buffer, events] : collect()) {
+        for (const auto& event : events) {
+            if (event.frame < 0) continue;
+            auto it = frames.try_emplace(event.frame).first; // Value initialized to zeros
+            it->second[static_cast<int>(event.stage)] += (event.end_ns - event.start_ns) / 1e6;
+        }
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Could not write the frame statistics " << path << std::endl;
+        return false;
+    }
+    file << "frame";
+    for (const char* name : STAGE_NAMES) {
+        file << "," << name << "_ms";
+    }
+    file << "\n" << std::fixed << std::setprecision(4);
+    for (const auto& [frame, stages] : frames) {
+        file << frame;
+        for (double ms : stages) {
+            file << "," << ms;
+        }
+        file << "\n";
+    }
+    std::cout << "Frame statistics written to " << path << std::endl;
+    return true;
+}
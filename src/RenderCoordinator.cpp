@@ -0,0 +1,239 @@
+#include "RenderCoordinator.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <tuple>
+
+RenderCoordinator::RenderCoordinator(Scene& scene, std::string address)
+    : scene(scene), address(std::move(address)) {}
+
+bool RenderCoordinator::run() {
+    std::vector<double> costs = scene.frame_costs();
+    total_frames = static_cast<int>(costs.size());
+    if (total_frames == 0) {
+        std::cerr << "The scene has no frames to render" << std::endl;
+        return false;
+    }
+    prefix.assign(costs.size() + 1, 0.0);
+    for (size_t i = 0; i < costs.size(); ++i) {
+        prefix[i + 1] = prefix[i] + costs[i];
+    }
+
+    int listen_fd = LineSocket::listen(address);
+    if (listen_fd < 0) {
+        return false;
+    }
+    pending.assign(1, {0, total_frames});
+    std::cout << "Serving " << total_frames << " frames on " << address << ", start workers with --worker " << address << std::endl;
+
+    // Once every frame is written the workers get DONE, the loop ends when they are gone
+    while (frames_done < total_frames || !workers.empty()) {
+        std::vector<pollfd> fds;
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& worker : workers) {
+            fds.push_back({worker->socket.fd(), POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        // Only the workers polled above, accepted ones are polled in the next round
+        size_t polled = workers.size();
+        for (size_t i = 0; i < polled; ++i) {
+            Worker& worker = *workers[i];
+            if (fds[i + 1].revents == 0 || !worker.socket.is_open()) continue;
+            if (!worker.socket.receive()) {
+                disconnect(worker);
+                continue;
+            }
+            std::string line;
+            while (worker.socket.is_open() && worker.socket.next_line(line)) {
+                handle(worker, line);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            auto worker = std::make_unique<Worker>();
+            worker->socket = LineSocket::accept(listen_fd);
+            if (worker->socket.is_open()) {
+                worker->id = next_worker++;
+                workers.push_back(std::move(worker));
+            }
+        }
+        workers.erase(std::remove_if(workers.begin(), workers.end(),
+            [](const std::unique_ptr<Worker>& worker) { return !worker->socket.is_open(); }), workers.end());
+    }
+    LineSocket::close_listener(listen_fd, address);
+    if (frames_done < total_frames) {
+        return false;
+    }
+    std::cout << "All " << total_frames << " frames written" << std::endl;
+    return true;
+}
+
+void RenderCoordinator::handle(Worker& worker, const std::string& line) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+
+    if (!worker.ready) {
+        int frames = -1;
+        if (command != "HELLO" || !(in >> frames) || frames != total_frames) {
+            std::cerr << "Worker " << worker.id << " rejected: expected HELLO " << total_frames << ", got '" << line << "'" << std::endl;
+            worker.socket.send_line("ERROR scene has " + std::to_string(total_frames) + " frames, worker has " + std::to_string(frames));
+            disconnect(worker);
+            return;
+        }
+        worker.ready = true;
+        worker.socket.send_line("OK");
+        std::cout << "Worker " << worker.id << " connected" << std::endl;
+        return;
+    }
+
+    if (command == "NEXT" && worker.unit < 0) {
+        worker.waiting = true;
+        assign(worker);
+        return;
+    }
+    int unit = -1, next = 0, count = 0;
+    if (command != "CLAIM" || !(in >> unit >> next >> count) || unit != worker.unit) {
+        std::cerr << "Worker " << worker.id << " sent an unexpected message '" << line << "'" << std::endl;
+        disconnect(worker);
+        return;
+    }
+
+    // Frames can only be reported once, and only those the worker was given
+    next = std::max(worker.next, std::min(next, worker.claimed));
+    frames_done += next - worker.next;
+    worker.next = next;
+    if (next >= worker.end) {
+        worker.unit = -1;
+        worker.socket.send_line("RANGE " + std::to_string(next) + " " + std::to_string(next));
+    } else {
+        worker.claimed = std::max(worker.claimed, std::min(worker.end, next + std::max(1, count)));
+        worker.socket.send_line("RANGE " + std::to_string(next) + " " + std::to_string(worker.claimed));
+    }
+    print_progress();
+
+    if (frames_done == total_frames) {
+        for (auto& other : workers) {
+            if (other->waiting) {
+                assign(*other);
+            }
+        }
+    }
+}
+
+// Replies to a NEXT: a unit from the pending frames, the back half of another unit or
+// DONE. Without any of them the worker keeps waiting for frames of a disconnected worker.
+void RenderCoordinator::assign(Worker& worker) {
+    if (frames_done == total_frames) {
+        worker.waiting = false;
+        worker.socket.send_line("DONE");
+        return;
+    }
+    int first = 0, end = 0;
+    if (!pending.empty()) {
+        // Guided: a share of what is left for every worker, so the units shrink towards
+        // the end and the last ones finish at about the same time
+        int ready = static_cast<int>(std::count_if(workers.begin(), workers.end(),
+            [](const std::unique_ptr<Worker>& other) { return other->ready && other->socket.is_open(); }));
+        double target = pending_cost() / (2.0 * std::max(1, ready));
+        std::tie(first, end) = pending.front();
+        pending.pop_front();
+        int split = split_at(first, end, target);
+        if (split < end) {
+            pending.push_front({split, end});
+        }
+        end = split;
+    } else if (!steal(worker, first, end)) {
+        return;
+    }
+
+    worker.waiting = false;
+    worker.unit = next_unit++;
+    worker.next = first;
+    worker.claimed = first;
+    worker.end = end;
+    worker.socket.send_line("UNIT " + std::to_string(worker.unit) + " " + std::to_string(first) + " " + std::to_string(end));
+    std::cout << "Unit " << worker.unit << " (frames " << first << ":" << end << ") to worker " << worker.id << std::endl;
+}
+
+// The back half by cost of the frames the busiest worker has not started yet
+bool RenderCoordinator::steal(Worker& thief, int& first, int& end) {
+    Worker* victim = nullptr;
+    double largest = 0;
+    for (auto& worker : workers) {
+        if (worker->unit < 0 || worker->claimed >= worker->end || !worker->socket.is_open()) continue;
+        double remaining = cost(worker->claimed, worker->end);
+        if (!victim || remaining > largest) {
+            victim = worker.get();
+            largest = remaining;
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+    first = victim->claimed;
+    if (victim->end - victim->claimed > 1) {
+        first = std::min(split_at(victim->claimed, victim->end, largest / 2), victim->end - 1);
+    }
+    end = victim->end;
+    victim->end = first;
+    std::cout << "Worker " << thief.id << " takes frames " << first << ":" << end << " from worker " << victim->id << std::endl;
+    return true;
+}
+
+void RenderCoordinator::disconnect(Worker& worker) {
+    worker.socket.close();
+    if (!worker.ready) {
+        return;
+    }
+    worker.ready = false;
+    worker.waiting = false;
+    if (worker.unit >= 0 && worker.next < worker.end) {
+        // Frames the worker was rendering may be half written, they are rendered again
+        std::cerr << "Worker " << worker.id << " disconnected, frames " << worker.next << ":" << worker.end << " are handed out again" << std::endl;
+        pending.push_front({worker.next, worker.end});
+        worker.unit = -1;
+        for (auto& other : workers) {
+            if (other->waiting && other->socket.is_open()) {
+                assign(*other);
+            }
+        }
+    } else {
+        std::cout << "Worker " << worker.id << " disconnected" << std::endl;
+    }
+}
+
+double RenderCoordinator::cost(int first, int end) const {
+    return prefix[end] - prefix[first];
+}
+
+double RenderCoordinator::pending_cost() const {
+    double total = 0;
+    for (const auto& range : pending) {
+        total += cost(range.first, range.second);
+    }
+    return total;
+}
+
+// Smallest split > first with cost(first, split) >= target, at most end
+int RenderCoordinator::split_at(int first, int end, double target) const {
+    auto begin = prefix.begin() + first + 1;
+    int split = static_cast<int>(std::lower_bound(begin, prefix.begin() + end, prefix[first] + target) - prefix.begin());
+    return std::min(split, end);
+}
+
+void RenderCoordinator::print_progress() {
+    int busy = static_cast<int>(std::count_if(workers.begin(), workers.end(),
+        [](const std::unique_ptr<Worker>& worker) { return worker->unit >= 0; }));
+    std::cout << "Frames written: " << frames_done << "/" << total_frames << " ("
+              << std::fixed << std::setprecision(1) << 100.0 * frames_done / total_frames << "%), "
+              << busy << " workers busy" << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,114 @@
+#include "RenderWorker.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+    // Frames rendered between two claims. Small enough that a stolen unit is noticed
+    // soon, large enough that the frames of a claim still run in parallel.
+    const int CLAIM_FRAMES = 8;
+    // The coordinator may still be loading its scene when the workers start
+    const int CONNECT_ATTEMPTS = 100;
+    const std::chrono::milliseconds CONNECT_RETRY(100);
+}
+
+RenderWorker::RenderWorker(Scene& scene, std::string address)
+    : scene(scene), address(std::move(address)) {}
+
+bool RenderWorker::run() {
+    if (!connect()) {
+        return false;
+    }
+    std::string reply;
+    if (!request("HELLO " + std::to_string(scene.get_total_frame_count()), reply)) {
+        return false;
+    }
+    if (reply != "OK") {
+        std::cerr << "Coordinator rejected the worker: " << reply << std::endl;
+        return false;
+    }
+
+    // The coordinator encodes once all frames are there, the statistics are printed once
+    scene.set_encode(false);
+    scene.set_summary(false);
+    while (request("NEXT", reply)) {
+        std::istringstream unit_reply(reply);
+        std::string command;
+        int unit = 0, first = 0, end = 0;
+        unit_reply >> command;
+        if (command == "DONE") {
+            scene.print_summary();
+            std::cout << "Worker finished, rendered " << frames_rendered << " frames" << std::endl;
+            return true;
+        }
+        if (command != "UNIT" || !(unit_reply >> unit >> first >> end)) {
+            break;
+        }
+        if (!render_unit(unit, first)) {
+            return false;
+        }
+    }
+    std::cerr << "Lost the connection to the coordinator at " << address << std::endl;
+    return false;
+}
+
+// One render of the unit. Its end grows by a claim whenever the frames claimed so far are
+// taken, the claims report the frames already written.
+bool RenderWorker::render_unit(int unit, int first) {
+    bool open = true; // The coordinator ends the unit with an empty range
+    bool failed = false;
+    auto claim = [&](int next, int written) {
+        if (!open || failed) {
+            return next;
+        }
+        std::string reply;
+        if (!request("CLAIM " + std::to_string(unit) + " " + std::to_string(written) + " " + std::to_string(next - written + CLAIM_FRAMES), reply)) {
+            std::cerr << "Lost the connection to the coordinator at " << address << std::endl;
+            failed = true;
+            return next;
+        }
+        std::istringstream range_reply(reply);
+        std::string command;
+        int range_first = 0, range_end = 0;
+        range_reply >> command >> range_first >> range_end;
+        if (command != "RANGE" || !range_reply) {
+            std::cerr << "Unexpected reply from the coordinator: " << reply << std::endl;
+            failed = true;
+            return next;
+        }
+        open = range_first < range_end;
+        return open ? range_end : next;
+    };
+
+    int end = claim(first, first);
+    if (end > first) {
+        scene.set_frame_range(first, end);
+        scene.set_range_extender(claim);
+        bool rendered = scene.render();
+        scene.finish();
+        scene.set_range_extender(nullptr);
+        if (!rendered) {
+            return false;
+        }
+        frames_rendered += scene.get_frame_count();
+        // All frames are written now, this ends the unit
+        claim(first + scene.get_frame_count(), first + scene.get_frame_count());
+    }
+    return !failed;
+}
+
+bool RenderWorker::connect() {
+    for (int attempt = 0; attempt < CONNECT_ATTEMPTS; ++attempt) {
+        if (socket.connect(address)) {
+            return true;
+        }
+        std::this_thread::sleep_for(CONNECT_RETRY);
+    }
+    std::cerr << "No coordinator at " << address << std::endl;
+    return false;
+}
+
+bool RenderWorker::request(const std::string& line, std::string& reply) {
+    return socket.send_line(line) && socket.read_line(reply);
+}
@@ -1,9 +1,13 @@
 #include "Scene.h"
+#include "GlowKernel.h"
+#include "Profiler.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
-#include "save_bmp.h"
+#include <omp.h>
 
 
 Scene::Scene(std::string path) {
@@ -28,6 +32,7 @@ Scene::Scene(std::string path) {
         //Load the five animators (for each platonic solid)
         //Read the color and the file for the keyframes from "path/scene.txt"
         img_path = path + "/imgs";
+        falloff_cache = std::make_shared<FalloffCache>();
         for (int i = 0; i < 5; ++i) {
             std::getline(file, line);
             float c_r, c_g, c_b;
@@ -40,21 +45,347 @@ Scene::Scene(std::string path) {
                 ImageGenerator imgGen = ImageGenerator(width, height);
                 Object object = Object::getObjectByName(objectName);
                 Animator ani = Animator(name, color, cam, imgGen, object, fps);
-                ani.load_keyframes(path + "/keyframes/" + keyframeFile);
+                // Parsed when needed, a render from a timeline never reads them
+                keyframe_paths.push_back(path + "/keyframes/" + keyframeFile);
+                ani.set_falloff_cache(falloff_cache);
                 animators.push_back(ani);
             }
         }
 
+        // Optional settings after the animators
+        load_options(file, path);
+        for (size_t i = 0; i < animators.size(); ++i) {
+            animators[i].set_noise(random_seed, static_cast<uint32_t>(i));
+        }
+        if (!lyrics_path.empty()) {
+            // Drawn at the output resolution, the text stays sharp with upscaling
+            auto layer = std::make_shared<const LyricsLayer>(lyrics_path, lyrics_style, width * upscale_factor, height * upscale_factor);
+            if (!layer->empty()) {
+                lyrics = layer;
+            }
+        }
+
         set_debug_mode(debug_mode);
+        set_render_settings(render_settings);
         file.close();
     }else {
         std::cout << "No scene file found at " << path << "/scene.txt" << std::endl;
         std::cout << "Please create a scene.txt file with the following format:" << std::endl;
         std::cout << "width height fps background_color_r background_color_g background_color_b upscale_factor debug_mode" << std::endl;
         std::cout << "color_r color_g color_b object_name keyframe_file" << std::endl;
+        std::cout << "Optionally followed by lines of: option_name value" << std::endl;
     }
 }
 
+void Scene::load_options(std::ifstream& file, const std::string& path) {
+    std::string option;
+    while (file >> option) {
+        if (option[0] == '#') {
+            std::string line;
+            std::getline(file, line);
+            continue;
+        }
+        if (option == "render_engine") {
+            std::string engine;
+            file >> engine;
+            if (engine == "mask") {
+                render_settings.engine = RenderEngine::Mask;
+            } else if (engine == "capsule") {
+                render_settings.engine = RenderEngine::Capsule;
+            } else {
+                std::cerr << "Unknown render engine: " << engine << ", using mask" << std::endl;
+                render_settings.engine = RenderEngine::Mask;
+            }
+        } else if (option == "simd") {
+            int simd_int = 1;
+            file >> simd_int;
+            render_settings.simd = (simd_int != 0);
+        } else if (option == "tile_size") {
+            file >> render_settings.tile_size;
+            if (render_settings.tile_size < 8) {
+                std::cerr << "tile_size must be at least 8, using 8" << std::endl;
+                render_settings.tile_size = 8;
+            }
+        } else if (option == "random_seed") {
+            file >> random_seed;
+        } else if (option == "frames_in_flight") {
+            file >> frames_in_flight;
+            if (frames_in_flight < 0) {
+                std::cerr << "frames_in_flight must not be negative, using 1" << std::endl;
+                frames_in_flight = 1;
+            }
+        } else if (option == "lyrics" || option == "lyrics_font") {
+            // Relative to the scene directory
+            std::string file_name;
+            file >> file_name;
+            if (!file_name.empty() && file_name[0] != '/') {
+                file_name = path + "/" + file_name;
+            }
+            (option == "lyrics" ? lyrics_path : lyrics_style.font_path) = file_name;
+        } else if (option == "lyrics_size") {
+            file >> lyrics_style.size;
+        } else if (option == "lyrics_color") {
+            file >> lyrics_style.color.x() >> lyrics_style.color.y() >> lyrics_style.color.z();
+        } else if (option == "lyrics_glow") {
+            file >> lyrics_style.glow_radius;
+        } else if (option == "writer_queue") {
+            file >> writer_queue;
+            if (writer_queue < 1) {
+                std::cerr << "writer_queue must be at least 1, using 1" << std::endl;
+                writer_queue = 1;
+            }
+        } else {
+            std::cerr << "Unknown scene option: " << option << std::endl;
+            std::string line;
+            std::getline(file, line);
+        }
+    }
+}
+
+void Scene::set_render_settings(const RenderSettings& settings) {
+    render_settings = settings;
+    for (auto& animator : animators) {
+        animator.set_render_settings(settings);
+    }
+}
+
+void Scene::set_y4m_output(const std::string& path) {
+    y4m_path = path;
+}
+
+void Scene::set_frame_range(int first, int end) {
+    first_frame = first;
+    end_frame = end;
+}
+
+void Scene::set_shard(int index, int count) {
+    shard_index = index;
+    shard_count = count;
+}
+
+std::vector<std::pair<int, int>> Scene::changed_frames(Scene& previous) {
+    load_keyframes();
+    previous.load_keyframes();
+    const std::vector<float>& times = prepare();
+    const std::vector<float>& previous_times = previous.prepare();
+    int num_frames = static_cast<int>(times.size());
+    if (num_frames == 0) {
+        return {};
+    }
+    if (animators.size() != previous.animators.size() || previous_times.empty() || times[0] != previous_times[0]) {
+        return {{0, num_frames}};
+    }
+
+    // Frame times only depend on the first time and fps, the frames both versions have
+    // are at the same times
+    std::vector<std::pair<int, int>> ranges;
+    for (size_t j = 0; j < animators.size(); ++j) {
+        const KeyframeSet& current = animators[j].get_keyframes();
+        const KeyframeSet& old = previous.animators[j].get_keyframes();
+        for (int c = 0; c < CHANNEL_COUNT; ++c) {
+            Channel channel = static_cast<Channel>(c);
+            for (const auto& interval : KeyframeSet::changed_intervals(old.channel(channel), current.channel(channel))) {
+                int first = static_cast<int>(std::lower_bound(times.begin(), times.end(), interval.first) - times.begin());
+                int end = static_cast<int>(std::upper_bound(times.begin(), times.end(), interval.second) - times.begin());
+                if (first < end) {
+                    ranges.push_back({first, end});
+                }
+            }
+        }
+    }
+    if (num_frames > static_cast<int>(previous_times.size())) {
+        ranges.push_back({static_cast<int>(previous_times.size()), num_frames});
+    }
+
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<int, int>> merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().second) {
+            merged.back().second = std::max(merged.back().second, range.second);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+void Scene::remove_frames(int first, int end) {
+    for (int i = first; i < end; ++i) {
+        std::error_code error;
+        std::filesystem::remove(BmpSink::frame_path(img_path, i), error);
+    }
+}
+
+std::vector<double> Scene::frame_costs() {
+    return estimate_frame_costs(prepare());
+}
+
+// Frame times, timeline and activity ranges, set up once so that a worker calling
+// render() for many small frame ranges does not redo them
+const std::vector<float>& Scene::prepare() {
+    if (prepared) {
+        return prepared_frame_times;
+    }
+    prepared = true;
+    if (!timeline_path.empty() && use_timeline()) {
+        prepared_frame_times.assign(timeline.frame_times(), timeline.frame_times() + timeline.frame_count());
+    } else {
+        prepared_frame_times = get_frame_times();
+    }
+    if (prepared_frame_times.empty()) {
+        return prepared_frame_times;
+    }
+    for (auto& animator : animators) {
+        animator.build_activity(prepared_frame_times);
+    }
+    return prepared_frame_times;
+}
+
+// Relative cost of every frame in shaded glow pixels. Evaluates the states like
+// render_frame without drawing: only animators whose state changed are drawn again, the
+// composite only runs when one of them did, and every frame is written.
+std::vector<double> Scene::estimate_frame_costs(const std::vector<float>& frame_times) {
+    // Per output pixel, relative to a shaded glow pixel. Fitted to --frame-stats of the
+    // shipped scenes.
+    const double OUTPUT_PIXEL_COST = 0.5;
+    const double COMPOSITE_PIXEL_COST = 0.3;
+    double output_pixels = static_cast<double>(width) * height * upscale_factor * upscale_factor;
+
+    std::vector<double> costs(frame_times.size(), OUTPUT_PIXEL_COST * output_pixels);
+    std::vector<bool> changed(frame_times.size(), false);
+    for (auto& animator : animators) {
+        AnimatorState last_state;
+        for (size_t i = 0; i < frame_times.size(); ++i) {
+            AnimatorState state = animator.evaluate(frame_times[i], static_cast<int>(i));
+            if (i > 0 && state == last_state) continue;
+            costs[i] += animator.estimate_cost(state);
+            changed[i] = true;
+            last_state = state;
+        }
+    }
+    for (size_t i = 0; i < frame_times.size(); ++i) {
+        if (changed[i]) costs[i] += COMPOSITE_PIXEL_COST * output_pixels;
+    }
+    return costs;
+}
+
+// count + 1 frame boundaries of contiguous shards with about the same total cost
+std::vector<int> Scene::split_by_cost(const std::vector<double>& costs, int count) {
+    std::vector<double> prefix(costs.size() + 1, 0.0);
+    for (size_t i = 0; i < costs.size(); ++i) {
+        prefix[i + 1] = prefix[i] + costs[i];
+    }
+    double total = prefix.back();
+
+    std::vector<int> bounds(count + 1, 0);
+    bounds[count] = static_cast<int>(costs.size());
+    for (int k = 1; k < count; ++k) {
+        double target = total * k / count;
+        // First boundary at or past the target, or the one before it when that is closer
+        int j = static_cast<int>(std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin());
+        if (j > 0 && target - prefix[j - 1] < prefix[j] - target) {
+            j--;
+        }
+        bounds[k] = std::max(bounds[k - 1], std::min(j, bounds[count]));
+    }
+
+    std::cout << "Shards by estimated cost:";
+    for (int k = 0; k < count; ++k) {
+        double share = total > 0 ? (prefix[bounds[k + 1]] - prefix[bounds[k]]) / total * 100 : 0;
+        std::cout << " " << bounds[k] << ":" << bounds[k + 1] << " (" << std::fixed << std::setprecision(1) << share << "%)";
+    }
+    std::cout << std::defaultfloat << std::endl;
+    return bounds;
+}
+
+void Scene::set_frame_cache(const std::string& directory) {
+    frame_cache = std::make_unique<FrameCache>(directory);
+}
+
+void Scene::set_timeline(const std::string& path) {
+    timeline_path = path;
+}
+
+void Scene::load_keyframes() {
+    if (keyframes_loaded) {
+        return;
+    }
+    keyframes_loaded = true;
+    for (size_t j = 0; j < animators.size(); ++j) {
+        animators[j].load_keyframes(keyframe_paths[j]);
+    }
+}
+
+// Hash of the raw keyframe files, in animator order, without parsing them. Everything
+// else the table depends on (fps, frame times) is stored next to it.
+uint64_t Scene::keyframe_checksum() const {
+    Fnv1a hash;
+    hash.add(static_cast<uint64_t>(keyframe_paths.size()));
+    for (const auto& path : keyframe_paths) {
+        MappedFile file;
+        size_t size = file.open(path) ? file.size() : 0; // Missing and empty files hash alike
+        hash.add(static_cast<uint64_t>(size));
+        hash.add(file.data(), size);
+    }
+    return hash.get();
+}
+
+// The frame times follow from the keyframe files and the fps
+bool Scene::timeline_matches(const Timeline& baked, uint64_t checksum) const {
+    return baked.header().checksum == checksum
+        && baked.animator_count() == static_cast<int>(animators.size())
+        && baked.header().fps == fps
+        && baked.frame_count() > 0;
+}
+
+bool Scene::bake(const std::string& path) {
+    load_keyframes();
+    std::vector<float> frame_times = get_frame_times();
+    if (frame_times.empty()) {
+        return false;
+    }
+    uint64_t checksum = keyframe_checksum();
+    {
+        Timeline existing;
+        if (existing.open(path) && timeline_matches(existing, checksum)
+            && existing.frame_count() == static_cast<int>(frame_times.size())
+            && std::equal(frame_times.begin(), frame_times.end(), existing.frame_times())) {
+            std::cout << "Timeline " << path << " is up to date" << std::endl;
+            return true;
+        }
+    }
+
+    int num_frames = frame_times.size();
+    std::vector<std::vector<float>> tables(animators.size(), std::vector<float>(static_cast<size_t>(num_frames) * CHANNEL_COUNT));
+    for (size_t j = 0; j < animators.size(); j++) {
+        animators[j].sample_keyframes(frame_times, tables[j].data());
+    }
+    if (!Timeline::write(path, checksum, fps, frame_times, tables)) {
+        return false;
+    }
+    std::cout << "Baked " << num_frames << " frames of " << animators.size() << " animators ("
+              << CHANNEL_COUNT << " channels) to " << path << std::endl;
+    return true;
+}
+
+bool Scene::use_timeline() {
+    if (!timeline.open(timeline_path)) {
+        std::cerr << "Could not open timeline " << timeline_path << ", evaluating the keyframes" << std::endl;
+        return false;
+    }
+    if (!timeline_matches(timeline, keyframe_checksum())) {
+        std::cerr << "Timeline " << timeline_path << " does not match the keyframe files, evaluating the keyframes" << std::endl;
+        timeline = Timeline();
+        return false;
+    }
+    for (size_t j = 0; j < animators.size(); j++) {
+        animators[j].set_timeline(timeline.table(j), timeline.frame_count());
+    }
+    timeline_active = true;
+    std::cout << "Reading channels from timeline " << timeline_path << std::endl;
+    return true;
+}
+
 void Scene::set_debug_mode(bool mode) {
     std::cout << "Setting debug mode to " << (mode ? "ON" : "OFF") << std::endl;
     debug_mode = mode;
@@ -64,74 +395,165 @@ void Scene::set_debug_mode(bool mode) {
 }
 
 void Scene::animate() {
+    if (render()) {
+        finish();
+    }
+}
+
+bool Scene::render() {
+    const std::vector<float>& frame_times = prepare();
     float start_time = get_animation_start_time();
     float end_time = get_animation_end_time();
     float duration = end_time - start_time;
     std::cout << start_time << " " << end_time << " " << duration << std::endl;
+    if (frame_times.empty()) {
+        return false;
+    }
+    int num_frames = frame_times.size();
 
-    int num_frames = static_cast<int>(duration * fps);
+    int first = std::max(0, first_frame);
+    int end = end_frame < 0 ? num_frames : std::min(end_frame, num_frames);
+    if (shard_count > 0) {
+        std::vector<int> bounds = split_by_cost(estimate_frame_costs(frame_times), shard_count);
+        first = bounds[shard_index];
+        end = bounds[shard_index + 1];
+    }
+    if (first >= end) {
+        std::cerr << "Frame range " << first << ":" << end << " is empty, the animation has " << num_frames << " frames" << std::endl;
+        return false;
+    }
+    frame_count = end - first;
+    partial = frame_count < num_frames;
 
-    if (num_frames <= 0) {
-        std::cerr << "Invalid number of frames!" << std::endl;
-        return;
+    compositor = Compositor(width, height, upscale_factor, backgroundColor);
+
+    // Frame parallel: every worker renders whole frames with its own animators, the
+    // tiles inside a frame then run on one thread. Noise only depends on the frame
+    // number, so the output does not depend on the schedule.
+    int workers = frames_in_flight == 0 ? omp_get_max_threads() : frames_in_flight;
+    if (!extend_range) {
+        workers = std::min(workers, frame_count);
     }
+    workers = std::max(1, workers);
+    create_contexts(workers);
 
-    if (duration <= 0) {
-        std::cerr << "Invalid animation duration!" << std::endl;
-        return;
+    int upscaled_width = width * upscale_factor;
+    int upscaled_height = height * upscale_factor;
+    if (y4m_path.empty()) {
+        sink = std::make_unique<BmpSink>(img_path, upscaled_width, upscaled_height);
+    } else {
+        sink = std::make_unique<Y4mSink>(y4m_path, upscaled_width, upscaled_height, fps);
     }
 
-    std::vector<Vector3f> screen(width * height, Vector3f(0.0f, 0.0f, 0.0f));
-    std::vector<Vector3f> upscaled_screen(width * height * upscale_factor * upscale_factor, Vector3f(0.0f, 0.0f, 0.0f));
-    std::vector<float> alpha(width * height, 0.0f);
+    // Frames go out on a background thread, the renderer only waits when the queue is full.
+    // Newly rendered frames are stored in the cache from there too.
+    frames_to_store.assign(num_frames, 0);
+    writer = std::make_unique<FrameWriter>(compositor.frame_size(), writer_queue, first,
+        [this](int frame_number, const std::vector<uint8_t>& data) {
+            sink->write(frame_number, data);
+            if (frame_cache && frames_to_store[frame_number] != 0) {
+                frame_cache->store(frames_to_store[frame_number], data);
+            }
+        });
 
-    for (int i = 0; i < num_frames; i++)
-    {
-        float time = start_time + i * (1.0f / fps);
-        std::cout << "Processing frame " << i + 1 << " of " << num_frames << ", Current time: " << time << std::endl;
-        for (size_t j = 0; j < animators.size(); j++){
-            animators[j].clear();
-            animators[j].render_frame(time);
-        }
-
-        // Add the current frame to the screen
-        std::vector<float> total_alpha(width * height, 0.0f);
-        std::vector<Vector3f> color_sum(width * height, Vector3f(0.0f, 0.0f, 0.0f));
-
-        // First pass: collect all contributions and calculate total alpha
-        for (size_t k = 0; k < animators.size(); k++) {
-            std::vector<float> a = animators[k].get_alpha();
-            #pragma omp parallel for
-            for (int l = 0; l < width * height; l++) {
-                total_alpha[l] += a[l];
-                color_sum[l] += animators[k].get_color() * a[l];
+    // Frames are taken in order. An extender moves the end once all frames before it
+    // are taken, until it stops the range.
+    int next = first;
+    bool extendable = static_cast<bool>(extend_range);
+    auto take_frame = [&]() {
+        int frame = -1;
+        #pragma omp critical(scene_frames)
+        {
+            if (next >= end && extendable) {
+                end = std::min(std::max(next, extend_range(next, writer->written_until())), num_frames);
+                extendable = end > next;
+            }
+            if (next < end) {
+                frame = next++;
             }
         }
+        return frame;
+    };
+    auto render_frames = [&](RenderContext& context) {
+        for (int i = take_frame(); i >= 0; i = take_frame()) {
+            float time = frame_times[i];
+            #pragma omp critical(scene_log)
+            std::cout << "Processing frame " << i + 1 << " of " << num_frames << ", Current time: " << time << std::endl;
+            render_frame(context, *writer, i, time);
+        }
+    };
 
-        // Second pass: normalize and blend with background
-        #pragma omp parallel for
-        for (int m = 0; m < width * height; m++) {
-            if (total_alpha[m] > 0.0f) {
-                // Normalize the color by total alpha to avoid over-saturation
-                Vector3f blended_color = color_sum[m] / total_alpha[m];
-                // Cap alpha at 1.0
-                float final_alpha = std::min(1.0f, total_alpha[m]);
-                // Blend with background
-                screen[m] = final_alpha * blended_color + (1.0f - final_alpha) * backgroundColor;
-            } else {
-                screen[m] = backgroundColor;
+    if (workers == 1) {
+        // Outside a parallel region, the tiles of each frame use all threads
+        render_frames(contexts[0]);
+    } else {
+        std::cout << "Rendering " << workers << " frames in flight" << std::endl;
+        #pragma omp parallel num_threads(workers)
+        render_frames(contexts[omp_get_thread_num()]);
+    }
+    frame_count = end - first;
+    partial = frame_count < num_frames;
+    return true;
+}
+
+void Scene::finish() {
+    if (!writer) {
+        return;
+    }
+    writer->finish();
+    sink->close();
+    writer->add_stats(writer_totals);
+    for (const auto& context : contexts) {
+        layers_rendered += context.layers_rendered;
+        layers_reused += context.layers_reused;
+        frames_composed += context.frames_composed;
+        frames_reused += context.frames_reused;
+    }
+    writer.reset();
+    sink.reset();
+    contexts.clear();
+
+    if (summary_enabled) {
+        // Printed at once, in a batch the next scene is already logging its frames
+        std::stringstream summary;
+        write_summary(summary);
+        if (!y4m_path.empty()) {
+            summary << "Animation completed and streamed to " << y4m_path << std::endl;
+        } else {
+            summary << "Animation completed and saved to " << img_path << std::endl;
+            if (partial) {
+                // The other shards write the rest of the frames next to these
+                summary << "Rendered " << frame_count << " frames of the animation, encode with --encode once all frames are there" << std::endl;
             }
         }
+        std::cout << summary.str() << std::flush;
+    }
+    if (y4m_path.empty() && !partial && encode_enabled) {
+        encode();
+    }
+}
 
-        save_image(i, screen);
-        
-        
+void Scene::print_summary() {
+    std::stringstream summary;
+    write_summary(summary);
+    std::cout << summary.str() << std::flush;
+}
 
-        // Save the current frame as an image
-        std::fill(screen.begin(), screen.end(), Vector3f(0.0f, 0.0f, 0.0f)); // Reset screen for next frame
-        std::fill(alpha.begin(), alpha.end(), 0.0f); // Reset alpha for next frame
+// Statistics of the renders since the last summary, then starts counting again
+void Scene::write_summary(std::ostream& out) {
+    FrameWriter::print_summary(out, writer_totals);
+    out << "Layers: " << layers_rendered << " rendered, " << layers_reused << " reused. Frames: "
+        << frames_composed << " composed, " << frames_reused << " reused" << std::endl;
+    if (frame_cache) {
+        frame_cache->print_summary(out);
     }
-    std::cout << "Animation completed and saved to " << img_path << std::endl;
+    writer_totals = FrameWriter::Stats();
+    layers_rendered = layers_reused = frames_composed = frames_reused = 0;
+}
+
+void Scene::encode() {
+    float start_time = get_animation_start_time();
+    float end_time = get_animation_end_time();
 
     // Load audio 
     std::stringstream ss;
@@ -146,64 +568,135 @@ void Scene::animate() {
 }
 
 
-void Scene::save_image(const int& frame_number, const std::vector<Vector3f>& screen) {
-    // Calculate the upscaled dimensions safely
-    size_t upscaled_width = static_cast<size_t>(width) * upscale_factor;
-    size_t upscaled_height = static_cast<size_t>(height) * upscale_factor;
-    
-    // Use size_t for safety with large allocations
-    std::vector<uint8_t> bmpData(upscaled_width * upscaled_height * 3);
-    
-    if (upscale_factor == 1) {
-        #pragma omp parallel for
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-
-                Vector3f c = screen[y * width + x];
-                size_t idx = (y * width + x) * 3;
-                // Bounds check
-                if (idx + 2 < bmpData.size()) {
-                    bmpData[idx + 0] = static_cast<uint8_t>(std::min(255.0f, c.x() * 255.0f));
-                    bmpData[idx + 1] = static_cast<uint8_t>(std::min(255.0f, c.y() * 255.0f));
-                    bmpData[idx + 2] = static_cast<uint8_t>(std::min(255.0f, c.z() * 255.0f));
-                }
-            }
+void Scene::create_contexts(int count) {
+    contexts.clear();
+    contexts.resize(count);
+    for (auto& context : contexts) {
+        context.animators = animators;
+        context.states.resize(animators.size());
+        context.frame.resize(compositor.frame_size());
+        // The animators do not move anymore, so the layers can point into them
+        for (const auto& animator : context.animators) {
+            context.layers.push_back(Layer{animator.get_alpha().data(), animator.get_color(), &animator.get_dirty()});
         }
-    } else {
-        #pragma omp parallel for
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                Vector3f c = screen[y * width + x];
-                for (int dy = 0; dy < upscale_factor; ++dy) {
-                    for (int dx = 0; dx < upscale_factor; ++dx) {
-                        size_t upscaled_x = static_cast<size_t>(x) * upscale_factor + dx;
-                        size_t upscaled_y = static_cast<size_t>(y) * upscale_factor + dy;
-                        size_t idx = (upscaled_y * upscaled_width + upscaled_x) * 3;
-                        
-                        // Add bounds check
-                        if (idx + 2 < bmpData.size()) {
-                            bmpData[idx + 0] = static_cast<uint8_t>(std::min(255.0f, c.x() * 255.0f));
-                            bmpData[idx + 1] = static_cast<uint8_t>(std::min(255.0f, c.y() * 255.0f));
-                            bmpData[idx + 2] = static_cast<uint8_t>(std::min(255.0f, c.z() * 255.0f));
-                        }
-                    }
-                }
-            }
+    }
+}
+
+void Scene::render_frame(RenderContext& context, FrameWriter& writer, int frame_number, float time) {
+    PROFILE_THREAD("render");
+    PROFILE_FRAME(frame_number);
+    PROFILE_SCOPE(Stage::Frame);
+    for (size_t j = 0; j < context.animators.size(); j++) {
+        context.states[j] = context.animators[j].evaluate(time, frame_number);
+    }
+
+    std::vector<uint8_t>* frame_data = nullptr;
+    if (frame_cache) {
+        uint64_t key = frame_key(context, time);
+        frame_data = writer.acquire(frame_number);
+        if (frame_cache->load(key, *frame_data)) {
+            writer.submit(frame_number, frame_data);
+            return;
         }
+        frames_to_store[frame_number] = key;
     }
-    
-    std::stringstream ss;
-    ss << img_path << "/frame_" << std::setfill('0') << std::setw(5) << frame_number << ".bmp";
-    enum save_bmp_result result = save_bmp(ss.str().c_str(), upscaled_width, upscaled_height, bmpData.data());
-    // Check the result of saving the BMP file
-    if (result != SAVE_BMP_SUCCESS) {
-        std::cerr << "!!!Error saving image: " << result << std::endl;
-        std::cerr << save_bmp_str_result(result) << std::endl;
-        return;
+
+    // Animators whose state did not change keep their layer
+    bool changed = false;
+    for (size_t j = 0; j < context.animators.size(); j++) {
+        if (context.animators[j].render(context.states[j])) {
+            changed = true;
+            context.layers_rendered++;
+        } else {
+            context.layers_reused++;
+        }
+    }
+
+    // Blend all animators over the background, only when a layer changed and only inside
+    // the layer rectangles of this and the previous composite
+    if (changed || !context.frame_valid) {
+        Rect layers_rect;
+        for (const auto& animator : context.animators) {
+            layers_rect.add(animator.get_dirty());
+        }
+        Rect region = layers_rect;
+        region.add(context.frame_rect);
+        if (!context.frame_valid) {
+            region = compositor.full_frame();
+        }
+        PROFILE_SCOPE(Stage::Composite);
+        compositor.compose(context.layers, context.frame.data(), region);
+        context.frame_rect = layers_rect;
+        context.frame_valid = true;
+        context.frames_composed++;
+    } else {
+        context.frames_reused++;
+    }
+
+    if (!frame_data) {
+        frame_data = writer.acquire(frame_number);
+    }
+    std::copy(context.frame.begin(), context.frame.end(), frame_data->begin());
+    if (lyrics) {
+        lyrics->draw(time, context.caption, frame_data->data());
+    }
+    writer.submit(frame_number, frame_data);
+}
+
+// Hash of everything that decides the pixels of a frame. The time is not part of it,
+// so identical frames are shared across the timeline and across scenes.
+uint64_t Scene::frame_key(const RenderContext& context, float time) const {
+    const int32_t FRAME_CACHE_VERSION = 1; // Bump when the renderer output changes
+    Fnv1a hash;
+    hash.add(FRAME_CACHE_VERSION);
+    hash.add(width);
+    hash.add(height);
+    hash.add(upscale_factor);
+    hash.add(backgroundColor.x());
+    hash.add(backgroundColor.y());
+    hash.add(backgroundColor.z());
+    hash.add(static_cast<int32_t>(debug_mode));
+    hash.add(static_cast<int32_t>(render_settings.engine));
+    // The path that runs, simd falls back to scalar without AVX2 and the pixels differ
+    hash.add(static_cast<int32_t>(render_settings.simd && GlowKernel::avx2Supported()));
+    hash.add(static_cast<uint64_t>(context.animators.size()));
+    for (size_t j = 0; j < context.animators.size(); j++) {
+        context.animators[j].add_to_hash(hash);
+        add_to_hash(hash, context.states[j]);
+    }
+    if (lyrics) {
+        lyrics->add_to_hash(hash, time);
+    }
+    return hash.get();
+}
+
+std::vector<float> Scene::get_frame_times() {
+    float start_time = get_animation_start_time();
+    float duration = get_animation_end_time() - start_time;
+    int num_frames = static_cast<int>(duration * fps);
+
+    if (num_frames <= 0) {
+        std::cerr << "Invalid number of frames!" << std::endl;
+        return {};
     }
+
+    if (duration <= 0) {
+        std::cerr << "Invalid animation duration!" << std::endl;
+        return {};
+    }
+
+    std::vector<float> frame_times(num_frames);
+    for (int i = 0; i < num_frames; i++) {
+        frame_times[i] = start_time + i * (1.0f / fps);
+    }
+    return frame_times;
 }
 
-float Scene::get_animation_start_time() const {
+float Scene::get_animation_start_time() {
+    if (timeline_active) {
+        return timeline.frame_times()[0];
+    }
+    load_keyframes();
     if (animators.empty()) {
         std::cerr << "No animators available to determine start time." << std::endl;
         return 0.0f;
@@ -218,7 +711,12 @@ float Scene::get_animation_start_time() const {
     return startTime;
 }
 
-float Scene::get_animation_end_time() const {
+float Scene::get_animation_end_time() {
+    if (timeline_active) {
+        // The table holds the frames, the last one lasts 1 / fps
+        return timeline.frame_times()[0] + static_cast<float>(timeline.frame_count()) / fps;
+    }
+    load_keyframes();
     if (animators.empty()) {
         std::cerr << "No animators available to determine end time." << std::endl;
         return 0.0f;
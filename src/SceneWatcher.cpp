@@ -0,0 +1,176 @@
+#include "SceneWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Editors write a file in several steps, the scene is loaded once they stopped
+    const int SETTLE_MS = 100;
+
+    std::string read_file(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+}
+
+SceneWatcher::SceneWatcher(std::string path) : path(std::move(path)) {}
+
+SceneWatcher::~SceneWatcher() {
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+}
+
+bool SceneWatcher::run() {
+    scene = load();
+    if (scene->get_total_frame_count() == 0) {
+        std::cerr << "Nothing to render in " << path << std::endl;
+        return false;
+    }
+    // Watch before rendering, edits made during the first render are picked up after it
+    if (!add_watches()) {
+        return false;
+    }
+    render({{0, scene->get_total_frame_count()}});
+    while (wait_for_change()) {
+        update();
+    }
+    return false;
+}
+
+std::unique_ptr<Scene> SceneWatcher::load() {
+    scene_text = read_file(path + "/scene.txt");
+    auto loaded = std::make_unique<Scene>(path);
+    if (!loaded->get_lyrics_path().empty()) {
+        scene_text += read_file(loaded->get_lyrics_path());
+    }
+    if (!frame_cache_dir.empty()) {
+        loaded->set_frame_cache(frame_cache_dir);
+    }
+    loaded->set_encode(false);
+    return loaded;
+}
+
+// The directories, not the files: most editors save by renaming a new file over the old one
+bool SceneWatcher::add_watches() {
+    inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        std::cerr << "inotify_init1 failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+    std::vector<std::string> directories = {path, path + "/keyframes"};
+    if (!scene->get_lyrics_path().empty()) {
+        directories.push_back(std::filesystem::path(scene->get_lyrics_path()).parent_path().string());
+    }
+    for (const std::string& directory : directories) {
+        if (inotify_add_watch(inotify_fd, directory.c_str(), mask) < 0) {
+            std::cerr << "Cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Watching " << path << "/scene.txt and the keyframe files, press Ctrl+C to stop" << std::endl;
+    return true;
+}
+
+bool SceneWatcher::wait_for_change() {
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    while (true) {
+        // Blocks for the first event, then only until the files are quiet again
+        pollfd fd = {inotify_fd, POLLIN, 0};
+        int ready = poll(&fd, 1, changed ? SETTLE_MS : -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) {
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (ready == 0) {
+            return true;
+        }
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) continue;
+            std::cerr << "Reading inotify events failed" << std::endl;
+            return false;
+        }
+        for (char* p = buffer; p < buffer + length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->len == 0) continue;
+            std::string name = event->name;
+            // Only scene.txt and the keyframe files of the scene, not swap or backup files
+            if (name == "scene.txt" || (!scene->get_lyrics_path().empty()
+                && std::filesystem::path(scene->get_lyrics_path()).filename() == name)) {
+                changed = true;
+                continue;
+            }
+            for (const auto& keyframe_path : scene->get_keyframe_paths()) {
+                if (std::filesystem::path(keyframe_path).filename() == name) {
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void SceneWatcher::update() {
+    auto start = Clock::now();
+    std::string previous_text = scene_text;
+    std::unique_ptr<Scene> loaded = load();
+    int num_frames = loaded->get_total_frame_count();
+    if (num_frames == 0) {
+        std::cerr << "The scene has no frames, keeping the last render until the next edit" << std::endl;
+        scene_text = previous_text;
+        return;
+    }
+
+    std::vector<std::pair<int, int>> ranges;
+    if (scene_text != previous_text) {
+        std::cout << "scene.txt or the lyrics changed, rendering all frames" << std::endl;
+        ranges = {{0, num_frames}};
+    } else {
+        ranges = loaded->changed_frames(*scene);
+    }
+    int previous_frames = scene->get_total_frame_count();
+    if (num_frames < previous_frames) {
+        loaded->remove_frames(num_frames, previous_frames);
+    }
+    scene = std::move(loaded);
+    if (ranges.empty()) {
+        std::cout << "No frames changed" << std::endl;
+        return;
+    }
+    render(ranges);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Updated in " << std::fixed << std::setprecision(2) << seconds << " s" << std::defaultfloat << std::endl;
+}
+
+void SceneWatcher::render(const std::vector<std::pair<int, int>>& ranges) {
+    int count = 0;
+    std::stringstream list;
+    for (const auto& range : ranges) {
+        count += range.second - range.first;
+        list << " " << range.first << ":" << range.second;
+    }
+    std::cout << "Rendering " << count << " of " << scene->get_total_frame_count() << " frames:" << list.str() << std::endl;
+    for (const auto& range : ranges) {
+        scene->set_frame_range(range.first, range.second);
+        if (scene->render()) {
+            scene->finish();
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#include "SegmentGrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Upper limit for the number of cells, the cell size grows if the path is too large
+    const int MAX_CELLS = 1 << 16;
+
+    float pointRectSquaredDistance(const Vector2f& p, const Vector2f& rect_min, const Vector2f& rect_max) {
+        float dx = std::max({rect_min.x() - p.x(), 0.0f, p.x() - rect_max.x()});
+        float dy = std::max({rect_min.y() - p.y(), 0.0f, p.y() - rect_max.y()});
+        return dx * dx + dy * dy;
+    }
+
+    // Liang-Barsky clipping of the line segment against the rectangle
+    bool segmentIntersectsRect(const Vector2f& a, const Vector2f& b, const Vector2f& rect_min, const Vector2f& rect_max) {
+        float u0 = 0.0f;
+        float u1 = 1.0f;
+        Vector2f d = b - a;
+        float p[4] = {-d.x(), d.x(), -d.y(), d.y()};
+        float q[4] = {a.x() - rect_min.x(), rect_max.x() - a.x(), a.y() - rect_min.y(), rect_max.y() - a.y()};
+        for (int i = 0; i < 4; ++i) {
+            if (p[i] == 0.0f) {
+                if (q[i] < 0.0f) return false;
+            } else {
+                float r = q[i] / p[i];
+                if (p[i] < 0.0f) {
+                    u0 = std::max(u0, r);
+                } else {
+                    u1 = std::min(u1, r);
+                }
+                if (u0 > u1) return false;
+            }
+        }
+        return true;
+    }
+
+    // Smallest distance between any point of the cell and the line
+    float cellSquaredDistance(const Line& line, const Vector2f& cell_min, const Vector2f& cell_max) {
+        if (segmentIntersectsRect(line.startPoint, line.endPoint, cell_min, cell_max)) return 0.0f;
+
+        // Without an intersection the closest pair of points involves an endpoint or a cell corner
+        float dist = std::min(pointRectSquaredDistance(line.startPoint, cell_min, cell_max),
+                              pointRectSquaredDistance(line.endPoint, cell_min, cell_max));
+        Vector2f corners[4] = {cell_min, Vector2f(cell_max.x(), cell_min.y()), Vector2f(cell_min.x(), cell_max.y()), cell_max};
+        for (const Vector2f& corner : corners) {
+            float d = line.squaredDistance(corner, line.get_t(corner));
+            if (d < dist) dist = d;
+        }
+        return dist;
+    }
+
+    // Largest distance between any point of the cell and the line
+    float cellMaxSquaredDistance(const Line& line, const Vector2f& cell_min, const Vector2f& cell_max) {
+        // The distance to a segment is convex, so its maximum over the cell is at one of the corners
+        Vector2f corners[4] = {cell_min, Vector2f(cell_max.x(), cell_min.y()), Vector2f(cell_min.x(), cell_max.y()), cell_max};
+        float dist = 0.0f;
+        for (const Vector2f& corner : corners) {
+            float d = line.squaredDistance(corner, line.get_t(corner));
+            if (std::isnan(d)) return d;
+            dist = std::max(dist, d);
+        }
+        return dist;
+    }
+}
+
+SegmentGrid::SegmentGrid()
+    : origin(0.0f, 0.0f), cell_size(1), cols(0), rows(0) {}
+
+void SegmentGrid::clear() {
+    cols = 0;
+    rows = 0;
+    cell_start.clear();
+    cell_lines.clear();
+    all_lines.clear();
+}
+
+int SegmentGrid::column(float x) const {
+    return (int)std::floor((x - origin.x()) / (float)cell_size);
+}
+
+int SegmentGrid::row(float y) const {
+    return (int)std::floor((y - origin.y()) / (float)cell_size);
+}
+
+void SegmentGrid::build(const LineSet& lineSet, int size, float margin) {
+    const std::vector<Line>& lines = lineSet.lines;
+    clear();
+    if (lines.empty()) return;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        all_lines.push_back(i);
+    }
+
+    Vector2f min_p = lines[0].startPoint;
+    Vector2f max_p = lines[0].startPoint;
+    for (const Line& line : lines) {
+        min_p = min_p.cwiseMin(line.startPoint).cwiseMin(line.endPoint);
+        max_p = max_p.cwiseMax(line.startPoint).cwiseMax(line.endPoint);
+    }
+    if (!min_p.allFinite() || !max_p.allFinite()) return;
+    // Cells start on whole pixels, so every cell is a screen tile of cell_size x cell_size pixels
+    min_p = (min_p - Vector2f(margin, margin)).array().floor();
+    max_p += Vector2f(margin, margin);
+
+    cell_size = std::max(size, 1);
+    Vector2f extent = max_p - min_p;
+    while (std::ceil(extent.x() / cell_size) * std::ceil(extent.y() / cell_size) > MAX_CELLS) {
+        cell_size *= 2;
+    }
+    origin = min_p;
+    cols = std::max(1, (int)std::ceil(extent.x() / cell_size));
+    rows = std::max(1, (int)std::ceil(extent.y() / cell_size));
+
+    cell_start.resize(cols * rows + 1);
+    for (int cy = 0; cy < rows; ++cy) {
+        for (int cx = 0; cx < cols; ++cx) {
+            Vector2f cell_min = origin + Vector2f((float)(cx * cell_size), (float)(cy * cell_size));
+            Vector2f cell_max = cell_min + Vector2f((float)cell_size, (float)cell_size);
+
+            // No point of the cell is further away from its nearest line than this bound
+            float bound = std::numeric_limits<float>::max();
+            for (const Line& line : lines) {
+                float d = cellMaxSquaredDistance(line, cell_min, cell_max);
+                if (d < bound) bound = d;
+            }
+            // Leave some slack for rounding in the distance computations
+            bound += bound * 1e-4f + 1e-3f;
+
+            cell_start[cy * cols + cx] = cell_lines.size();
+            for (size_t i = 0; i < lines.size(); ++i) {
+                if (cellSquaredDistance(lines[i], cell_min, cell_max) <= bound) {
+                    cell_lines.push_back(i);
+                }
+            }
+        }
+    }
+    cell_start[cols * rows] = cell_lines.size();
+}
+
+SegmentHit SegmentGrid::nearest(const LineSet& lineSet, const Vector2f& point) const {
+    if (empty()) return lineSet.nearest(point);
+
+    int cx = column(point.x());
+    int cy = row(point.y());
+    if (cx < 0 || cx >= cols || cy < 0 || cy >= rows) return lineSet.nearest(point);
+
+    // Same scan as LineSet::nearest, restricted to the candidates of the cell.
+    // Candidates are in ascending order, so ties resolve to the same line.
+    const std::vector<Line>& lines = lineSet.lines;
+    SegmentHit hit;
+    int cell = cy * cols + cx;
+    for (int k = cell_start[cell]; k < cell_start[cell + 1]; ++k) {
+        int i = cell_lines[k];
+        float t = lines[i].get_t(point);
+        float dist = lines[i].squaredDistance(point, t);
+        if (dist < hit.squared_distance) {
+            hit.squared_distance = dist;
+            hit.index = i;
+            hit.t = t;
+        }
+    }
+    return hit;
+}
+
+int SegmentGrid::run(int x, int x_end, int y, const int*& begin, const int*& end) const {
+    // Returns the end of the pixel run [x, end) on row y that shares one candidate list
+    int cy = empty() ? -1 : row((float)y);
+    int cx = empty() ? -1 : column((float)x);
+    if (cy < 0 || cy >= rows || cx >= cols) {
+        begin = all_lines.data();
+        end = all_lines.data() + all_lines.size();
+        return x_end;
+    }
+
+    int next = x + 1;
+    while (next < x_end && column((float)next) == cx) {
+        ++next;
+    }
+    if (cx < 0) {
+        begin = all_lines.data();
+        end = all_lines.data() + all_lines.size();
+    } else {
+        int cell = cy * cols + cx;
+        begin = cell_lines.data() + cell_start[cell];
+        end = cell_lines.data() + cell_start[cell + 1];
+    }
+    return next;
+}
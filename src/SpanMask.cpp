@@ -0,0 +1,66 @@
+#include "SpanMask.h"
+#include <algorithm>
+
+SpanMask::SpanMask()
+    : width(0), height(0), first_row(0), last_row(-1), min_x(0), max_x(-1) {}
+
+void SpanMask::reset(int width, int height) {
+    // Only the rows touched by the previous frame need clearing
+    for (int y = first_row; y <= last_row; ++y) {
+        rows[y].clear();
+    }
+    this->width = width;
+    this->height = height;
+    if ((int)rows.size() != height) {
+        rows.assign(height, std::vector<Span>());
+    }
+    first_row = height;
+    last_row = -1;
+    min_x = width;
+    max_x = -1;
+}
+
+void SpanMask::addRect(int min_x, int max_x, int min_y, int max_y) {
+    min_x = std::max(min_x, 0);
+    max_x = std::min(max_x, width - 1);
+    min_y = std::max(min_y, 0);
+    max_y = std::min(max_y, height - 1);
+    if (min_x > max_x || min_y > max_y) return;
+
+    for (int y = min_y; y <= max_y; ++y) {
+        rows[y].push_back(Span{min_x, max_x + 1});
+    }
+    first_row = std::min(first_row, min_y);
+    last_row = std::max(last_row, max_y);
+    this->min_x = std::min(this->min_x, min_x);
+    this->max_x = std::max(this->max_x, max_x);
+}
+
+void SpanMask::merge() {
+    for (int y = first_row; y <= last_row; ++y) {
+        std::vector<Span>& spans = rows[y];
+        if (spans.size() < 2) continue;
+        std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.x0 < b.x0; });
+
+        // Fuse overlapping and touching spans in place
+        size_t n = 0;
+        for (size_t i = 1; i < spans.size(); ++i) {
+            if (spans[i].x0 <= spans[n].x1) {
+                spans[n].x1 = std::max(spans[n].x1, spans[i].x1);
+            } else {
+                spans[++n] = spans[i];
+            }
+        }
+        spans.resize(n + 1);
+    }
+}
+
+size_t SpanMask::pixelCount() const {
+    size_t count = 0;
+    for (int y = first_row; y <= last_row; ++y) {
+        for (const Span& span : rows[y]) {
+            count += span.x1 - span.x0;
+        }
+    }
+    return count;
+}
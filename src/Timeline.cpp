@@ -0,0 +1,81 @@
+#include "Timeline.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[4] = {'P', 'A', 'T', 'L'};
+}
+
+bool Timeline::write(const std::string& path, uint64_t checksum, int fps,
+                     const std::vector<float>& frame_times, const std::vector<std::vector<float>>& tables) {
+    Header header;
+    std::copy(MAGIC, MAGIC + 4, header.magic);
+    header.version = VERSION;
+    header.channel_count = CHANNEL_COUNT;
+    header.animator_count = tables.size();
+    header.frame_count = frame_times.size();
+    header.fps = fps;
+    header.checksum = checksum;
+
+    // Renamed into place, a reader never maps a half written table
+    std::stringstream tmp;
+    tmp << path << ".tmp." << getpid();
+    {
+        std::ofstream file(tmp.str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(frame_times.data()), frame_times.size() * sizeof(float));
+        for (const auto& table : tables) {
+            file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(float));
+        }
+        if (!file) {
+            std::cerr << "Error writing timeline " << tmp.str() << std::endl;
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp.str(), path, error);
+    if (error) {
+        std::cerr << "Error storing timeline " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(tmp.str(), error);
+        return false;
+    }
+    return true;
+}
+
+bool Timeline::open(const std::string& path) {
+    if (!file.open(path)) {
+        return false;
+    }
+    if (file.size() < sizeof(Header) || !std::equal(MAGIC, MAGIC + 4, header().magic)) {
+        std::cerr << path << " is not a timeline file" << std::endl;
+        file.close();
+        return false;
+    }
+    if (header().version != VERSION || header().channel_count != CHANNEL_COUNT) {
+        std::cerr << "Timeline " << path << " has version " << header().version << " with "
+                  << header().channel_count << " channels, expected version " << VERSION << " with "
+                  << CHANNEL_COUNT << std::endl;
+        file.close();
+        return false;
+    }
+    size_t expected = sizeof(Header) + sizeof(float) * static_cast<size_t>(header().frame_count)
+        * (1 + static_cast<size_t>(header().animator_count) * CHANNEL_COUNT);
+    if (file.size() != expected) {
+        std::cerr << "Timeline " << path << " has the wrong size for its header" << std::endl;
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+const float* Timeline::frame_times() const {
+    return reinterpret_cast<const float*>(static_cast<const char*>(file.data()) + sizeof(Header));
+}
+
+const float* Timeline::table(int animator) const {
+    return frame_times() + header().frame_count + static_cast<size_t>(animator) * header().frame_count * CHANNEL_COUNT;
+}
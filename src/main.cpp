@@ -5,8 +5,41 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <vector>
 #include "Animator.h"
 #include "Scene.h"
+#include "BatchRenderer.h"
+#include "RenderCoordinator.h"
+#include "RenderWorker.h"
+#include "SceneWatcher.h"
+#include "Profiler.h"
+
+// "a:b", "a:" or ":b" into [first, end), end -1 for the last frame
+bool parse_frame_range(const std::string& text, int& first, int& end) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) return false;
+    std::string a = text.substr(0, colon), b = text.substr(colon + 1);
+    try {
+        first = a.empty() ? 0 : std::stoi(a);
+        end = b.empty() ? -1 : std::stoi(b);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return first >= 0 && (end < 0 || end > first);
+}
+
+// "i/N" with 0 <= i < N
+bool parse_shard(const std::string& text, int& index, int& count) {
+    size_t slash = text.find('/');
+    if (slash == std::string::npos) return false;
+    try {
+        index = std::stoi(text.substr(0, slash));
+        count = std::stoi(text.substr(slash + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return count > 0 && index >= 0 && index < count;
+}
 
 std::string snprint_to_string(int data) {
   char buffer[6];
@@ -16,20 +49,186 @@ std::string snprint_to_string(int data) {
 
 int main(int argc, char** argv)
 {
-    std::cout << "Platonic Animation Application" << std::endl;
+    std::vector<std::string> scene_names;
+    bool batch = false;
+    std::string trace_path;
+    std::string frame_stats_path;
+    std::string frames_text;
+    std::string shard_text;
+    bool encode_only = false;
+    bool watch = false;
+    std::string serve_address;
+    std::string worker_address;
+    std::string y4m_path;
+    std::string frame_cache_dir;
+    std::string bake_path;
+    std::string timeline_path;
 
-    std::string scene_name; // Default scene
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--y4m" && i + 1 < argc) {
+            y4m_path = argv[++i];
+        } else if (arg == "--frame-cache" && i + 1 < argc) {
+            frame_cache_dir = argv[++i];
+        } else if (arg == "--bake" && i + 1 < argc) {
+            bake_path = argv[++i];
+        } else if (arg == "--timeline" && i + 1 < argc) {
+            timeline_path = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--frame-stats" && i + 1 < argc) {
+            frame_stats_path = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames_text = argv[++i];
+        } else if (arg == "--shard" && i + 1 < argc) {
+            shard_text = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_address = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            worker_address = argv[++i];
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--encode") {
+            encode_only = true;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " <scene> [--y4m <path|->] [--frame-cache <dir>] [--bake <file>] [--timeline <file>]"
+                      << " [--trace <file>] [--frame-stats <file>] [--frames <a:b> | --shard <i/N>] [--encode]"
+                      << " [--serve <address> | --worker <address>] [--watch]" << std::endl;
+            std::cerr << "       " << argv[0] << " --batch <scene>... [--frame-cache <dir>] [--trace <file>]" << std::endl;
+            return 1;
+        } else {
+            scene_names.push_back(arg);
+        }
+    }
 
-    if (argc > 1) {
-        scene_name = argv[1];
-    } else {
+    // stdout carries the video stream, all logging goes to stderr
+    if (y4m_path == "-") {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    std::cout << "Platonic Animation Application" << std::endl;
+
+    if (scene_names.empty()) {
         std::cerr << "No scene name provided." << std::endl;
         return 1;
     }
 
-    Scene scene(scene_name);
+    if (!trace_path.empty() || !frame_stats_path.empty()) {
+        if (!Profiler::compiled_in) {
+            std::cerr << "--trace and --frame-stats need a build with PLATONIC_PROFILING" << std::endl;
+            return 1;
+        }
+        Profiler::enable();
+    }
 
-    scene.animate();
+    if (batch) {
+        if (!y4m_path.empty() || !bake_path.empty() || !timeline_path.empty() || !frame_stats_path.empty()
+            || !frames_text.empty() || !shard_text.empty() || encode_only || !serve_address.empty() || !worker_address.empty() || watch) {
+            std::cerr << "--y4m, --bake, --timeline, --frame-stats, --frames, --shard, --encode, --serve, --worker and --watch take a single scene"
+                      << " and cannot be used with --batch" << std::endl;
+            return 1;
+        }
+        BatchRenderer renderer(scene_names);
+        if (!frame_cache_dir.empty()) {
+            renderer.set_frame_cache(frame_cache_dir);
+        }
+        bool ok = renderer.run();
+        renderer.print_summary(std::cout);
+        if (!trace_path.empty()) {
+            ok = Profiler::write_trace(trace_path) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+    if (scene_names.size() > 1) {
+        std::cerr << "Got " << scene_names.size() << " scenes, use --batch to render several scenes" << std::endl;
+        return 1;
+    }
+
+    int first_frame = 0, end_frame = -1, shard_index = 0, shard_count = 0;
+    if (!frames_text.empty() && !parse_frame_range(frames_text, first_frame, end_frame)) {
+        std::cerr << "Invalid frame range " << frames_text << ", expected first:end, e.g. 0:600 or 600:" << std::endl;
+        return 1;
+    }
+    if (!shard_text.empty() && !parse_shard(shard_text, shard_index, shard_count)) {
+        std::cerr << "Invalid shard " << shard_text << ", expected i/N with 0 <= i < N" << std::endl;
+        return 1;
+    }
+    if (!frames_text.empty() && !shard_text.empty()) {
+        std::cerr << "--frames and --shard cannot be combined" << std::endl;
+        return 1;
+    }
+
+    if (!serve_address.empty() || !worker_address.empty()) {
+        if (!serve_address.empty() && !worker_address.empty()) {
+            std::cerr << "--serve and --worker cannot be combined, start the workers as separate processes" << std::endl;
+            return 1;
+        }
+        if (!y4m_path.empty() || !bake_path.empty() || !frames_text.empty() || !shard_text.empty() || encode_only) {
+            std::cerr << "--y4m, --bake, --frames, --shard and --encode cannot be used with --serve or --worker" << std::endl;
+            return 1;
+        }
+    }
+
+    if (watch) {
+        if (!y4m_path.empty() || !bake_path.empty() || !timeline_path.empty() || !trace_path.empty() || !frame_stats_path.empty()
+            || !frames_text.empty() || !shard_text.empty() || encode_only || !serve_address.empty() || !worker_address.empty()) {
+            std::cerr << "--watch can only be combined with --frame-cache" << std::endl;
+            return 1;
+        }
+        SceneWatcher watcher(scene_names[0]);
+        if (!frame_cache_dir.empty()) {
+            watcher.set_frame_cache(frame_cache_dir);
+        }
+        return watcher.run() ? 0 : 1;
+    }
+
+    Scene scene(scene_names[0]);
+    if (encode_only) {
+        scene.encode();
+        return 0;
+    }
+    if (!bake_path.empty()) {
+        return scene.bake(bake_path) ? 0 : 1;
+    }
+    if (!timeline_path.empty()) {
+        scene.set_timeline(timeline_path);
+    }
+    if (!y4m_path.empty()) {
+        scene.set_y4m_output(y4m_path);
+    }
+    if (!frame_cache_dir.empty()) {
+        scene.set_frame_cache(frame_cache_dir);
+    }
+    if (!frames_text.empty()) {
+        scene.set_frame_range(first_frame, end_frame);
+    }
+    if (shard_count > 0) {
+        scene.set_shard(shard_index, shard_count);
+    }
+
+    if (!serve_address.empty()) {
+        RenderCoordinator coordinator(scene, serve_address);
+        if (!coordinator.run()) {
+            return 1;
+        }
+        scene.encode();
+    } else if (!worker_address.empty()) {
+        RenderWorker worker(scene, worker_address);
+        if (!worker.run()) {
+            return 1;
+        }
+    } else {
+        scene.animate();
+    }
+    if (!trace_path.empty() && !Profiler::write_trace(trace_path)) {
+        return 1;
+    }
+    if (!frame_stats_path.empty() && !Profiler::write_frame_csv(frame_stats_path)) {
+        return 1;
+    }
 
 
 